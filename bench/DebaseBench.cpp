@@ -0,0 +1,573 @@
+//===- bench/DebaseBench.cpp ----------------------------------------------===//
+//
+// Copyright (C) 2026 Ninefold
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// Generates a synthetic corpus of bitcode modules and runs the driver over
+/// it, reporting the throughput and peak memory of each phase.
+///
+/// Modules are shaped like the examples: `simple` lists every class in the
+/// config (examples/Simple), `filename` uses a single `{file.stem}` pattern
+/// (examples/Filename).
+///
+//===----------------------------------------------------------------------===//
+
+#include "LLVM.hpp"
+#include "Shared.hpp"
+#include "TargetInit.hpp"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Object/ArchiveWriter.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/WithColor.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace debase_tool;
+using namespace llvm;
+
+#ifndef DEBASE_BENCH_DRIVER
+# define DEBASE_BENCH_DRIVER "debase"
+#endif
+
+namespace {
+
+enum SeedShape {
+  simple,
+  filename,
+};
+
+enum ABIKind {
+  itanium,
+  msvc,
+  mixed,
+};
+
+} // namespace `anonymous`
+
+static cl::OptionCategory BenchCategory("Benchmark Options");
+
+static cl::opt<std::string>
+DriverPath("debase",
+           cl::desc("The driver to benchmark"), cl::value_desc("path"),
+           cl::init(DEBASE_BENCH_DRIVER), cl::cat(BenchCategory));
+
+static cl::opt<unsigned>
+NumModules("modules",
+           cl::desc("Amount of modules in the corpus"),
+           cl::init(64), cl::cat(BenchCategory));
+
+static cl::opt<unsigned>
+NumFunctions("functions",
+             cl::desc("Amount of debased functions per module"),
+             cl::init(32), cl::cat(BenchCategory));
+
+static cl::opt<double>
+CtorRatio("ctor-ratio",
+          cl::desc("Fraction of debased functions which are constructors"),
+          cl::init(0.5), cl::cat(BenchCategory));
+
+static cl::opt<unsigned>
+Depth("depth",
+      cl::desc("Namespace nesting depth of each class"),
+      cl::init(2), cl::cat(BenchCategory));
+
+static cl::opt<unsigned>
+BodySize("body-size",
+         cl::desc("Extra instructions outside the marked region"),
+         cl::init(16), cl::cat(BenchCategory));
+
+static cl::opt<ABIKind>
+ABI("abi",
+  cl::desc("The C++ ABI of the generated modules:"),
+  cl::init(ABIKind::itanium), cl::cat(BenchCategory),
+  cl::values(
+    clEnumVal(itanium, "Itanium triples (the default)"),
+    clEnumVal(msvc,    "MSVC triples"),
+    clEnumVal(mixed,   "Alternate between both")));
+
+static cl::opt<bool>
+Archived("archive",
+         cl::desc("Pack the corpus into a single archive"),
+         cl::cat(BenchCategory));
+
+static cl::opt<SeedShape>
+Seed("seed",
+  cl::desc("The config the corpus is shaped after:"),
+  cl::init(SeedShape::simple), cl::cat(BenchCategory),
+  cl::values(
+    clEnumVal(simple,   "List every class (examples/Simple)"),
+    clEnumVal(filename, "Match on the file stem (examples/Filename)")));
+
+static cl::opt<unsigned>
+ExtraPatterns("extra-patterns",
+              cl::desc("Patterns added to the config which never match"),
+              cl::init(0), cl::cat(BenchCategory));
+
+static cl::opt<unsigned>
+Repeat("repeat",
+       cl::desc("Runs of each phase, the fastest is reported"),
+       cl::init(3), cl::cat(BenchCategory));
+
+static cl::opt<unsigned>
+Jobs("jobs",
+     cl::desc("Worker threads passed to the driver (0 = all cores)"),
+     cl::init(0), cl::cat(BenchCategory));
+
+static cl::opt<bool>
+CodeGen("codegen",
+        cl::desc("Also benchmark --emit-obj"),
+        cl::cat(BenchCategory));
+
+static cl::list<std::string>
+DriverArgs("driver-args", cl::CommaSeparated,
+           cl::desc("Extra arguments passed to every driver run"),
+           cl::value_desc("args"), cl::cat(BenchCategory));
+
+static cl::opt<std::string>
+WorkDir("work-dir",
+        cl::desc("Where the corpus is generated (default: temporary)"),
+        cl::value_desc("dir"), cl::cat(BenchCategory));
+
+static cl::opt<bool>
+Keep("keep",
+     cl::desc("Keep the generated corpus"),
+     cl::cat(BenchCategory));
+
+static cl::opt<std::string>
+JSONOut("json",
+        cl::desc("Also write the results as JSON"),
+        cl::value_desc("file"), cl::cat(BenchCategory));
+
+//======================================================================//
+// Generation
+//======================================================================//
+
+static bool IsMSVCModule(unsigned MI) {
+  return ABI == msvc || (ABI == mixed && (MI & 1));
+}
+
+/// Returns if the `FI`th function is a ctor, spreading them evenly.
+static bool IsCtorFunction(unsigned FI) {
+  const double Ratio = std::clamp(CtorRatio.getValue(), 0.0, 1.0);
+  return unsigned(FI * Ratio) != unsigned((FI + 1) * Ratio);
+}
+
+static std::string GetModuleStem(unsigned MI) {
+  return ("Mod" + Twine(MI)).str();
+}
+
+static std::string GetClassName(unsigned MI, unsigned FI) {
+  if (Seed == filename)
+    return (GetModuleStem(MI) + "C" + Twine(FI)).str();
+  return ("C" + Twine(MI) + "_" + Twine(FI)).str();
+}
+
+/// Mangles the complete ctor/dtor of `Scope::Name`.
+static std::string MangleSpecial(ArrayRef<std::string> Scope, StringRef Name,
+                                 bool IsCtor, bool IsMSVC) {
+  std::string Out;
+  raw_string_ostream OS(Out);
+  if (IsMSVC) {
+    OS << (IsCtor ? "??0" : "??1") << Name << '@';
+    for (const std::string& S : llvm::reverse(Scope))
+      OS << S << '@';
+    OS << "@QEAA@XZ";
+    return Out;
+  }
+  OS << "_ZN";
+  for (const std::string& S : Scope)
+    OS << S.size() << S;
+  OS << Name.size() << Name << (IsCtor ? "C2Ev" : "D2Ev");
+  return Out;
+}
+
+namespace {
+
+/// Builds a single module of the corpus.
+class ModuleBuilder {
+  LLVMContext& Ctx;
+  std::unique_ptr<Module> M;
+  const bool IsMSVC;
+  Function* MarkBegin = nullptr;
+  Function* MarkEnd = nullptr;
+  Function* Work = nullptr;
+
+public:
+  ModuleBuilder(LLVMContext& Ctx, unsigned MI)
+   : Ctx(Ctx), IsMSVC(IsMSVCModule(MI)) {
+    const std::string Stem = GetModuleStem(MI);
+    M = std::make_unique<Module>(Stem + ".cpp", Ctx);
+    M->setSourceFileName(Stem + ".cpp");
+    M->setTargetTriple(IsMSVC ? "x86_64-pc-windows-msvc"
+                              : "x86_64-unknown-linux-gnu");
+    auto* Void = Type::getVoidTy(Ctx);
+    auto* Ptr = PointerType::getUnqual(Ctx);
+    auto* MarkTy = FunctionType::get(Void, false);
+    MarkBegin = getMarker("__debase_mark_begin", MarkTy);
+    MarkEnd = getMarker("__debase_mark_end", MarkTy);
+    Work = Function::Create(
+      FunctionType::get(Void, {Ptr, Type::getInt32Ty(Ctx)}, false),
+      GlobalValue::ExternalLinkage, "bench_work", *M);
+  }
+
+  /// Adds the ctor/dtor of a class deriving from a base with the same kind.
+  void addSpecial(ArrayRef<std::string> Scope, StringRef Name,
+                  unsigned FI, bool IsCtor) {
+    const std::string BaseName = ("Base" + Twine(FI)).str();
+    Function* Base = createSpecial({"base"}, BaseName, IsCtor);
+    IRBuilder<> B(BasicBlock::Create(Ctx, "", Base));
+    finishSpecial(B, Base);
+
+    Function* F = createSpecial(Scope, Name, IsCtor);
+    B.SetInsertPoint(BasicBlock::Create(Ctx, "", F));
+    Value* This = F->getArg(0);
+    if (IsCtor) {
+      B.CreateCall(Base, {This});
+      addBody(B, This);
+      addRegion(B, This);
+    } else {
+      addRegion(B, This);
+      addBody(B, This);
+      B.CreateCall(Base, {This});
+    }
+    finishSpecial(B, F);
+  }
+
+  std::unique_ptr<Module> take() { return std::move(M); }
+
+private:
+  Function* getMarker(StringRef Name, FunctionType* Ty) {
+    auto* F = Function::Create(Ty, GlobalValue::ExternalLinkage, Name, *M);
+    F->setCallingConv(CallingConv::PreserveMost);
+    return F;
+  }
+
+  Function* createSpecial(ArrayRef<std::string> Scope, StringRef Name,
+                          bool IsCtor) {
+    auto* Ptr = PointerType::getUnqual(Ctx);
+    // MSVC ctors return `this`.
+    Type* Ret = (IsMSVC && IsCtor) ? Ptr : Type::getVoidTy(Ctx);
+    return Function::Create(FunctionType::get(Ret, {Ptr}, false),
+                            GlobalValue::ExternalLinkage,
+                            MangleSpecial(Scope, Name, IsCtor, IsMSVC), *M);
+  }
+
+  void finishSpecial(IRBuilder<>& B, Function* F) {
+    if (F->getReturnType()->isVoidTy())
+      B.CreateRetVoid();
+    else
+      B.CreateRet(F->getArg(0));
+  }
+
+  void callMarker(IRBuilder<>& B, Function* Marker) {
+    CallInst* CI = B.CreateCall(Marker);
+    CI->setCallingConv(CallingConv::PreserveMost);
+    CI->setTailCallKind(CallInst::TCK_NoTail);
+  }
+
+  /// Member initialization, which is scanned but never removed.
+  void addBody(IRBuilder<>& B, Value* This) {
+    auto* I32 = B.getInt32Ty();
+    for (unsigned I = 0; I < BodySize / 2; ++I) {
+      Value* Field = B.CreateConstInBoundsGEP1_32(I32, This, I + 2);
+      B.CreateStore(B.getInt32(I), Field);
+    }
+  }
+
+  /// The user's body, between the markers.
+  void addRegion(IRBuilder<>& B, Value* This) {
+    callMarker(B, MarkBegin);
+    B.CreateCall(Work, {This, B.getInt32(0)});
+    callMarker(B, MarkEnd);
+  }
+};
+
+/// Everything written to the work directory.
+struct Corpus {
+  std::string ConfigPath;
+  std::string OutputDir;
+  uint64_t NumBytes = 0;
+};
+
+} // namespace `anonymous`
+
+static Error WriteFile(StringRef Path, StringRef Data) {
+  std::error_code EC;
+  raw_fd_ostream OS(Path, EC, sys::fs::OF_None);
+  if (EC)
+    return createFileError(Path, EC);
+  OS << Data;
+  return Error::success();
+}
+
+static Expected<Corpus> GenerateCorpus(StringRef Dir) {
+  Corpus C;
+  SmallString<128> InputDir(Dir), OutputDir(Dir);
+  sys::path::append(InputDir, "corpus");
+  sys::path::append(OutputDir, "out");
+  for (StringRef D : {InputDir.str(), OutputDir.str()})
+    if (auto EC = sys::fs::create_directories(D))
+      return createFileError(D, EC);
+  C.OutputDir = OutputDir.str().str();
+
+  std::vector<std::string> Scope;
+  for (unsigned I = 0; I < Depth; ++I)
+    Scope.push_back(("ns" + Twine(I)).str());
+  std::string ScopePrefix;
+  for (const std::string& S : Scope)
+    ScopePrefix += S + "::";
+
+  std::vector<std::string> Patterns;
+  std::vector<std::string> Files;
+  // Buffers are kept alive for the archive.
+  std::vector<SmallString<0>> Bitcode;
+  std::vector<std::string> MemberNames;
+  Bitcode.reserve(NumModules);
+
+  for (unsigned MI = 0; MI < NumModules; ++MI) {
+    LLVMContext Ctx;
+    ModuleBuilder MB(Ctx, MI);
+    for (unsigned FI = 0; FI < NumFunctions; ++FI) {
+      const std::string Name = GetClassName(MI, FI);
+      MB.addSpecial(Scope, Name, FI, IsCtorFunction(FI));
+      if (Seed == simple)
+        Patterns.push_back(ScopePrefix + Name);
+    }
+    std::unique_ptr<Module> M = MB.take();
+    InitializeBitcodeWriterFor(M->getTargetTriple());
+    SmallString<0>& Buf = Bitcode.emplace_back();
+    raw_svector_ostream OS(Buf);
+    WriteBitcodeToFile(*M, OS);
+    C.NumBytes += Buf.size();
+
+    MemberNames.push_back(GetModuleStem(MI) + ".bc");
+    if (Archived)
+      continue;
+    SmallString<128> Path(InputDir);
+    sys::path::append(Path, MemberNames.back());
+    if (Error E = WriteFile(Path, Buf))
+      return std::move(E);
+    Files.push_back(sys::path::convert_to_slash(Path));
+  }
+
+  if (Archived) {
+    std::vector<NewArchiveMember> Members;
+    for (unsigned MI = 0; MI < NumModules; ++MI)
+      Members.emplace_back(MemoryBufferRef(Bitcode[MI], MemberNames[MI]));
+    SmallString<128> Path(InputDir);
+    sys::path::append(Path, "corpus.a");
+    if (Error E = writeArchive(Path, Members, SymtabWritingMode::NormalSymtab,
+                               object::Archive::K_GNU,
+                               /*Deterministic=*/true, /*Thin=*/false))
+      return std::move(E);
+    Files.push_back(sys::path::convert_to_slash(Path));
+  }
+
+  if (Seed == filename)
+    Patterns.push_back("**::/{file.stem}*/");
+  for (unsigned I = 0; I < ExtraPatterns; ++I)
+    Patterns.push_back((ScopePrefix + "Filler" + Twine(I)).str());
+
+  std::string Config;
+  raw_string_ostream OS(Config);
+  json::OStream J(OS, 2);
+  J.object([&] {
+    J.attributeArray("patterns", [&] {
+      for (const std::string& P : Patterns)
+        J.value(P);
+    });
+    J.attributeArray("files", [&] {
+      for (const std::string& F : Files)
+        J.value(F);
+    });
+  });
+  SmallString<128> ConfigPath(Dir);
+  sys::path::append(ConfigPath, "config.json");
+  if (Error E = WriteFile(ConfigPath, Config))
+    return std::move(E);
+  C.ConfigPath = ConfigPath.str().str();
+  return C;
+}
+
+//======================================================================//
+// Running
+//======================================================================//
+
+namespace {
+
+struct PhaseResult {
+  std::string Name;
+  double Seconds = 0.0;
+  /// Peak RSS in kilobytes, if known.
+  std::optional<uint64_t> PeakKB;
+};
+
+} // namespace `anonymous`
+
+/// Runs the driver `Repeat` times with `Args`, keeping the fastest run.
+static Expected<PhaseResult> RunPhase(StringRef Name, const Corpus& C,
+                                      ArrayRef<std::string> Args,
+                                      StringRef LogPath) {
+  std::vector<StringRef> Argv {DriverPath, "--config", C.ConfigPath};
+  for (const std::string& A : Args)
+    Argv.push_back(A);
+  const std::string JobsArg = "-j" + utostr(Jobs);
+  Argv.push_back(JobsArg);
+  for (const std::string& A : DriverArgs)
+    Argv.push_back(A);
+
+  PhaseResult R {Name.str(), 0.0, std::nullopt};
+  const std::optional<StringRef> Redirects[] = {std::nullopt, LogPath, LogPath};
+  for (unsigned I = 0; I < std::max(1u, Repeat.getValue()); ++I) {
+    std::string ErrMsg;
+    std::optional<sys::ProcessStatistics> Stats;
+    auto Start = std::chrono::steady_clock::now();
+    int RC = sys::ExecuteAndWait(DriverPath, Argv, std::nullopt, Redirects,
+                                 /*SecondsToWait=*/0, /*MemoryLimit=*/0,
+                                 &ErrMsg, nullptr, &Stats);
+    std::chrono::duration<double> Elapsed =
+      std::chrono::steady_clock::now() - Start;
+    if (RC != 0)
+      return MakeError("phase '" + Name + "' failed (" + Twine(RC) + "): "
+                       + (ErrMsg.empty() ? "see " + LogPath.str() : ErrMsg));
+    if (I == 0 || Elapsed.count() < R.Seconds)
+      R.Seconds = Elapsed.count();
+    if (Stats)
+      R.PeakKB = std::max(R.PeakKB.value_or(0), Stats->PeakMemory);
+  }
+  return R;
+}
+
+static void PrintResults(ArrayRef<PhaseResult> Results, const Corpus& C) {
+  const double MB = double(C.NumBytes) / (1024.0 * 1024.0);
+  outs() << "corpus: " << NumModules << " modules, "
+         << NumModules * NumFunctions << " functions, "
+         << format("%.2f", MB) << " MB\n\n";
+  outs() << format("%-10s %12s %10s %10s %14s\n",
+                   "phase", "modules/s", "MB/s", "wall (ms)", "peak RSS (MB)");
+  for (const PhaseResult& R : Results) {
+    const double Secs = std::max(R.Seconds, 1e-9);
+    outs() << format("%-10s %12.1f %10.2f %10.1f ", R.Name.c_str(),
+                     NumModules / Secs, MB / Secs, R.Seconds * 1000.0);
+    if (R.PeakKB)
+      outs() << format("%14.1f\n", *R.PeakKB / 1024.0);
+    else
+      outs() << format("%14s\n", "-");
+  }
+}
+
+static Error WriteJSON(StringRef Path, ArrayRef<PhaseResult> Results,
+                       const Corpus& C) {
+  std::string Out;
+  raw_string_ostream OS(Out);
+  json::OStream J(OS, 2);
+  J.object([&] {
+    J.attribute("modules", int64_t(NumModules));
+    J.attribute("functions", int64_t(NumFunctions));
+    J.attribute("bytes", int64_t(C.NumBytes));
+    J.attributeArray("phases", [&] {
+      for (const PhaseResult& R : Results) {
+        J.object([&] {
+          J.attribute("name", R.Name);
+          J.attribute("seconds", R.Seconds);
+          if (R.PeakKB)
+            J.attribute("peak_rss_kb", int64_t(*R.PeakKB));
+        });
+      }
+    });
+  });
+  return WriteFile(Path, Out);
+}
+
+int main(int Argc, char** Argv) {
+  InitLLVM X(Argc, Argv);
+  cl::HideUnrelatedOptions(BenchCategory);
+  cl::ParseCommandLineOptions(Argc, Argv, "debase benchmarks\n");
+  InitializeTargetInfos();
+
+  auto Fail = [] (Error E) -> int {
+    WithColor::error(errs()) << toString(std::move(E)) << '\n';
+    return 1;
+  };
+
+  if (!sys::fs::can_execute(DriverPath))
+    return Fail(MakeError("'" + DriverPath + "' is not executable"));
+
+  SmallString<128> Dir(WorkDir);
+  if (Dir.empty()) {
+    if (auto EC = sys::fs::createUniqueDirectory("debase-bench", Dir))
+      return Fail(createFileError("debase-bench", EC));
+  } else if (auto EC = sys::fs::create_directories(Dir))
+    return Fail(createFileError(Dir, EC));
+
+  std::vector<PhaseResult> Results;
+  auto Start = std::chrono::steady_clock::now();
+  Expected<Corpus> C = GenerateCorpus(Dir);
+  if (!C)
+    return Fail(C.takeError());
+  std::chrono::duration<double> GenTime =
+    std::chrono::steady_clock::now() - Start;
+  Results.push_back({"generate", GenTime.count(), std::nullopt});
+
+  SmallString<128> LogPath(Dir);
+  sys::path::append(LogPath, "driver.log");
+  auto Run = [&] (StringRef Name, ArrayRef<std::string> Args) -> bool {
+    Expected<PhaseResult> R = RunPhase(Name, *C, Args, LogPath);
+    if (!R) {
+      Fail(R.takeError());
+      return false;
+    }
+    Results.push_back(std::move(*R));
+    return true;
+  };
+
+  // Loading, matching and debasing, without writing anything.
+  bool Ok = Run("debase", {"--disable-output"});
+  // The full pipeline.
+  Ok = Ok && Run("write", {"-o", C->OutputDir});
+  if (Ok && CodeGen)
+    Ok = Run("emit-obj", {"-o", C->OutputDir, "--emit-obj"});
+
+  PrintResults(Results, *C);
+  if (!JSONOut.empty())
+    if (Error E = WriteJSON(JSONOut, Results, *C))
+      return Fail(std::move(E));
+
+  if (Keep || !WorkDir.empty())
+    outs() << "\ncorpus kept in '" << Dir << "'\n";
+  else
+    sys::fs::remove_directories(Dir);
+  return Ok ? 0 : 1;
+}
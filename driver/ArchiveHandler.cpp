@@ -31,6 +31,7 @@
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/StringSaver.h"
 #include "llvm/Support/WithColor.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -63,10 +64,29 @@ static Error MBError(MemoryBufferRef MB, Error OtherErr) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
-static Error extract(object::Archive* Archive, MemoryBufferRef MB,
-                     std::vector<MemoryBufferRef>& Out,
-                     llvm::BumpPtrAllocator& BP) {
-  assert(!Archive->isThin() && "Setup invalid?");
+/// Called with the name and contents of each valid member. Members of thin
+/// archives are mapped from their own files, which are passed in `Owner`.
+using MemberVisitor = function_ref<void(StringRef Name, StringRef Data,
+                                        std::unique_ptr<MemoryBuffer> Owner)>;
+
+/// Maps the file a thin member refers to, relative to the archive.
+static Expected<StringRef>
+ mapThinMember(const object::Archive::Child& C,
+               std::unique_ptr<MemoryBuffer>& Owner) {
+  Expected<std::string> PathOrErr = C.getFullName();
+  if (!PathOrErr)
+    return PathOrErr.takeError();
+  // Members are only copied if they need a null terminator.
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufOrErr = MemoryBuffer::getFile(
+    *PathOrErr, /*IsText=*/false, /*RequiresNullTerminator=*/false);
+  if (auto EC = BufOrErr.getError())
+    return createFileError(*PathOrErr, EC);
+  Owner = std::move(*BufOrErr);
+  return Owner->getBuffer();
+}
+
+static Error walk(object::Archive* Archive, MemoryBufferRef MB,
+                  MemberVisitor Visit) {
   int ErrCount = 0;
   auto RecognizeError = [&ErrCount, MB] (const Twine& Msg) {
     if (debase_tool::Verbose)
@@ -89,11 +109,13 @@ static Error extract(object::Archive* Archive, MemoryBufferRef MB,
     StringRef Name = NameOrErr.get();
     
     // Get the data and its length
-    Expected<StringRef> BufOrErr = C.getBuffer();
+    std::unique_ptr<MemoryBuffer> Owner;
+    Expected<StringRef> BufOrErr = Archive->isThin()
+      ? mapThinMember(C, Owner) : C.getBuffer();
     if (!BufOrErr) {
       if (!Permissive)
-        return MBError(MB, NameOrErr.takeError());
-      RecognizeError(toString(NameOrErr.takeError()));
+        return MBError(MB, BufOrErr.takeError());
+      RecognizeError(toString(BufOrErr.takeError()));
       continue;
     }
     StringRef Data = BufOrErr.get();
@@ -119,10 +141,7 @@ static Error extract(object::Archive* Archive, MemoryBufferRef MB,
       }
     }
 
-    // Intern because otherwise it tweaks the fuck out
-    Data = InternStringRef(BP, Data);
-    Name = InternStringRef(BP, Name);
-    Out.emplace_back(Data, Name);
+    Visit(Name, Data, std::move(Owner));
   }
 
   if (Err)
@@ -132,23 +151,57 @@ static Error extract(object::Archive* Archive, MemoryBufferRef MB,
   return Error::success();
 }
 
-Error debase_tool::extractInMemoryARFile(MemoryBufferRef MB,
-                                         std::vector<MemoryBufferRef>& Out,
-                                         llvm::BumpPtrAllocator& BP) {
+static Expected<std::unique_ptr<object::Archive>>
+openInMemoryARFile(MemoryBufferRef MB) {
   auto ArchiveOrError = object::Archive::create(MB);
   if (!ArchiveOrError)
     return MBError(MB, ArchiveOrError.takeError());
 
-  std::unique_ptr<object::Archive> Archive = std::move(ArchiveOrError.get());
-  if (Archive->isThin())
-    return MBError(MB, "extracting from a thin archive is not supported.");
-  return extract(Archive.get(), MB, Out, BP);
+  return std::move(ArchiveOrError.get());
+}
+
+Error debase_tool::extractInMemoryARFile(MemoryBufferRef MB,
+                                         std::vector<MemoryBufferRef>& Out,
+                                         llvm::BumpPtrAllocator& BP,
+                                         ThinMemberList& ThinMembers) {
+  auto ArchiveOrError = openInMemoryARFile(MB);
+  if (!ArchiveOrError)
+    return ArchiveOrError.takeError();
+  auto Visit = [&] (StringRef Name, StringRef Data,
+                    std::unique_ptr<MemoryBuffer> Owner) {
+    // Members point directly into the archive, which the caller keeps alive.
+    // Textual IR is the exception, as the parser requires a null terminator.
+    if (identify_magic(Data) != file_magic::bitcode)
+      Data = InternStringRef(BP, Data);
+    else if (Owner)
+      ThinMembers.push_back(std::move(Owner));
+    Out.emplace_back(Data, Name);
+  };
+  return walk(ArchiveOrError->get(), MB, Visit);
+}
+
+Error debase_tool::streamInMemoryARFile(MemoryBufferRef MB,
+                                        ARMemberCallback CB) {
+  auto ArchiveOrError = openInMemoryARFile(MB);
+  if (!ArchiveOrError)
+    return ArchiveOrError.takeError();
+  auto Visit = [CB] (StringRef Name, StringRef Data,
+                     std::unique_ptr<MemoryBuffer> Owner) {
+    if (identify_magic(Data) == file_magic::bitcode)
+      return CB(MemoryBufferRef(Data, Name));
+    // Textual IR needs a null terminator, so copy it for the callback.
+    std::unique_ptr<MemoryBuffer> Copy =
+      MemoryBuffer::getMemBufferCopy(Data, Name);
+    CB(Copy->getMemBufferRef());
+  };
+  return walk(ArchiveOrError->get(), MB, Visit);
 }
 
 Error debase_tool::extractARFile(const Twine& ArchiveName,
                                  std::unique_ptr<MemoryBuffer>& OutMB,
                                  std::vector<MemoryBufferRef>& Out,
-                                 llvm::BumpPtrAllocator& BP) {
+                                 llvm::BumpPtrAllocator& BP,
+                                 ThinMemberList& ThinMembers) {
   ErrorOr<std::unique_ptr<MemoryBuffer>> BufOrErr
       = MemoryBuffer::getFile(ArchiveName, /*IsText=*/false);
   if (auto EC = BufOrErr.getError()) {
@@ -159,35 +212,38 @@ Error debase_tool::extractARFile(const Twine& ArchiveName,
   // Do the real stuff...
   MemoryBufferRef MB(**BufOrErr);
   OutMB = std::move(*BufOrErr);
-  return extractInMemoryARFile(MB, Out, BP);
+  return extractInMemoryARFile(MB, Out, BP, ThinMembers);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 static constexpr SymtabWritingMode SymTab = SymtabWritingMode::NormalSymtab;
-static constexpr bool Thin = false;
 static constexpr bool Deterministic = false;
 
-static Expected<NewArchiveMember> getArchiveMember(StringRef FileName) {
+static Expected<NewArchiveMember> getArchiveMember(StringRef FileName,
+                                                   StringRef ArchiveName,
+                                                   StringSaver& Saver,
+                                                   bool Thin) {
   Expected<NewArchiveMember> NMOrErr =
       NewArchiveMember::getFile(FileName, Deterministic);
   if (!NMOrErr)
     return createFileError(FileName, NMOrErr.takeError());
-  NMOrErr->MemberName = sys::path::filename(NMOrErr->MemberName);
+  if (!Thin) {
+    NMOrErr->MemberName = sys::path::filename(NMOrErr->MemberName);
+    return NMOrErr;
+  }
+  // Thin members are found relative to the archive.
+  Expected<std::string> PathOrErr =
+      computeArchiveRelativePath(ArchiveName, FileName);
+  if (!PathOrErr)
+    return createFileError(FileName, PathOrErr.takeError());
+  NMOrErr->MemberName = Saver.save(sys::path::convert_to_slash(*PathOrErr));
   return NMOrErr;
 }
 
-static Error performWriteOperation(raw_fd_ostream* OS,
-                                   StringRef ArchiveName,
-                                   const UniqueStringVector& Files) {
-  std::vector<NewArchiveMember> NewMembers;
-  for (auto& FileName : Files) {
-    Expected<NewArchiveMember> NMOrErr = getArchiveMember(FileName);
-    if (!Permissive)
-      return NMOrErr.takeError();
-    NewMembers.push_back(std::move(*NMOrErr));
-  }
-
+static Error writeMembers(raw_fd_ostream* OS, StringRef ArchiveName,
+                          ArrayRef<NewArchiveMember> NewMembers,
+                          bool Thin = false) {
   object::Archive::Kind Kind
       = !NewMembers.empty() ? NewMembers.front().detectKindFromObject()
                             : object::Archive::getDefaultKind();
@@ -199,13 +255,41 @@ static Error performWriteOperation(raw_fd_ostream* OS,
                                     Deterministic, Thin);
 }
 
+static Error performWriteOperation(raw_fd_ostream* OS,
+                                   StringRef ArchiveName,
+                                   const UniqueStringVector& Files,
+                                   bool Thin) {
+  BumpPtrAllocator Alloc;
+  StringSaver Saver(Alloc);
+  std::vector<NewArchiveMember> NewMembers;
+  for (auto& FileName : Files) {
+    Expected<NewArchiveMember> NMOrErr =
+        getArchiveMember(FileName, ArchiveName, Saver, Thin);
+    if (!NMOrErr) {
+      if (!Permissive)
+        return NMOrErr.takeError();
+      WithColor::warning(errs()) << toString(NMOrErr.takeError()) << '\n';
+      continue;
+    }
+    NewMembers.push_back(std::move(*NMOrErr));
+  }
+  return writeMembers(OS, ArchiveName, NewMembers, Thin);
+}
+
 Error debase_tool::createARFile(raw_fd_ostream& OS,
                                 StringRef ArchiveName,
-                                const UniqueStringVector& Files) {
-  return performWriteOperation(&OS, ArchiveName, Files);
+                                const UniqueStringVector& Files,
+                                bool Thin) {
+  return performWriteOperation(&OS, ArchiveName, Files, Thin);
 }
 
 Error debase_tool::createARFile(StringRef ArchiveName,
-                                const UniqueStringVector& Files) {
-  return performWriteOperation(nullptr, ArchiveName, Files);
+                                const UniqueStringVector& Files,
+                                bool Thin) {
+  return performWriteOperation(nullptr, ArchiveName, Files, Thin);
+}
+
+Error debase_tool::createARFile(raw_fd_ostream& OS,
+                                ArrayRef<NewArchiveMember> Members) {
+  return writeMembers(&OS, "", Members);
 }
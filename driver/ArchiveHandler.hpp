@@ -25,6 +25,8 @@
 
 #include "LLVM.hpp"
 #include "UniqueStringVector.hpp"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLFunctionalExtras.h"
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/MemoryBufferRef.h"
 #include "llvm/Support/Error.h"
@@ -32,28 +34,52 @@
 #include <vector>
 
 namespace llvm {
+struct NewArchiveMember;
 class MemoryBuffer;
 class raw_fd_ostream;
 } // namespace llvm
 
 namespace debase_tool {
 
-/// Extracts x-archive file contents into `Out`.
+/// The mapped members of thin archives.
+using ThinMemberList = std::vector<std::unique_ptr<llvm::MemoryBuffer>>;
+
+/// Extracts x-archive file contents into `Out`. Bitcode members reference `MB`
+/// directly, so it must outlive `Out`. Textual members are copied into `BP`.
+/// Members of thin archives are mapped from disk into `ThinMembers`.
 llvm::Error extractInMemoryARFile(llvm::MemoryBufferRef MB,
                                   std::vector<llvm::MemoryBufferRef>& Out,
-                                  llvm::BumpPtrAllocator& BP);
+                                  llvm::BumpPtrAllocator& BP,
+                                  ThinMemberList& ThinMembers);
+
+/// Called for each member of an archive. The member is only valid for the
+/// duration of the call.
+using ARMemberCallback = llvm::function_ref<void(llvm::MemoryBufferRef)>;
+
+/// Passes each x-archive member to `CB` as it is read, in archive order.
+/// Thin members are mapped for the duration of the call.
+llvm::Error streamInMemoryARFile(llvm::MemoryBufferRef MB,
+                                 ARMemberCallback CB);
 
 /// Extracts x-archive file contents into `Out`.
 llvm::Error extractARFile(const Twine& ArchiveName,
                           std::unique_ptr<llvm::MemoryBuffer>& OutMB,
                           std::vector<llvm::MemoryBufferRef>& Out,
-                          llvm::BumpPtrAllocator& BP);
+                          llvm::BumpPtrAllocator& BP,
+                          ThinMemberList& ThinMembers);
 
+/// Archives `Files`. Thin archives reference them relative to `ArchiveName`.
 llvm::Error createARFile(llvm::raw_fd_ostream& OS,
                          StringRef ArchiveName,
-                         const UniqueStringVector& Files);
+                         const UniqueStringVector& Files,
+                         bool Thin = false);
 
 llvm::Error createARFile(StringRef ArchiveName,
-                         const UniqueStringVector& Files);
+                         const UniqueStringVector& Files,
+                         bool Thin = false);
+
+/// Writes `Members` as an archive, with a symbol table for the linker.
+llvm::Error createARFile(llvm::raw_fd_ostream& OS,
+                         llvm::ArrayRef<llvm::NewArchiveMember> Members);
 
 } // namespace debase_tool
@@ -0,0 +1,368 @@
+//===- driver/CompiledConfig.cpp ------------------------------------------===//
+//
+// Copyright (C) 2026 Ninefold
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// Writes and maps compiled configs. Patterns are rebuilt from their tokens,
+/// which is cheap compared to parsing and lexing, and point into the image.
+///
+//===----------------------------------------------------------------------===//
+
+#include "CompiledConfig.hpp"
+#include "Shared.hpp"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <array>
+#include <cstring>
+
+using namespace debase_tool;
+using namespace debase_tool::compiled_config;
+using namespace llvm;
+
+void SymbolMatcher::recordConfig() {
+  assert(!ConfigFilename && "Config has already been loaded!");
+  if (!Recorded)
+    Recorded = std::make_unique<ConfigRecord>();
+}
+
+//===----------------------------------------------------------------------===//
+// Writing
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// Deduplicated, null terminated strings.
+class StringTableBuilder {
+  SmallString<0> Data;
+  StringMap<uint32_t> Offsets;
+public:
+  std::pair<uint32_t, uint32_t> add(StringRef S) {
+    auto [It, DidEmplace] = Offsets.try_emplace(S, Data.size());
+    if (DidEmplace) {
+      Data.append(S);
+      Data.push_back('\0');
+    }
+    return {It->second, uint32_t(S.size())};
+  }
+  StringRef data() const { return Data; }
+};
+} // namespace `anonymous`
+
+/// Encodes where the data of `Tok` lives.
+static uint32_t EncodeTokenData(Pattern::Token Tok, StringTableBuilder& ST) {
+  if (Tok.data == nullptr)
+    return TD_Null;
+  if (Tok.data == Pattern::Token::kStem)
+    return TD_Stem;
+  if (Tok.data == Pattern::Token::kDir)
+    return TD_Dir;
+  if (Tok.data == Pattern::Token::kExt)
+    return TD_Ext;
+  return ST.add(Tok.str()).first;
+}
+
+Error SymbolMatcher::writeCompiledConfig(raw_ostream& OS,
+                                         ArrayRef<std::string> Files) const {
+  if (!Recorded)
+    return MakeError("the config wasn't recorded");
+
+  StringTableBuilder ST;
+  std::vector<std::array<uint32_t, 5>> Patterns;
+  std::vector<std::array<uint32_t, 4>> Tokens;
+  for (const ConfigRecord::PatternInfo& Info : Recorded->Patterns) {
+    Pattern* P = PatternMappings.lookup(Info.Source);
+    if (!P)
+      continue;
+    const uint32_t Flags = (CtorPatterns.contains(P) ? PF_Ctor : 0)
+                         | (DtorPatterns.contains(P) ? PF_Dtor : 0);
+    auto [SrcOff, SrcSize] = ST.add(Info.Source);
+    Patterns.push_back({SrcOff, SrcSize, uint32_t(Tokens.size()),
+                        uint32_t(Info.Tokens.size()), Flags});
+    for (Pattern::Token Tok : Info.Tokens) {
+      const uint32_t Bits = Tok.trailing | (Tok.grouped << 3)
+                          | (Tok.modified << 4);
+      Tokens.push_back({uint32_t(Tok.kind), EncodeTokenData(Tok, ST),
+                        uint32_t(Tok.size), Bits});
+    }
+  }
+
+  std::vector<std::array<uint32_t, 3>> Trie;
+  std::vector<std::pair<uint32_t, uint32_t>> TrieNames;
+  for (const ConfigRecord::TrieInfo& Info : Recorded->Basetrie) {
+    Trie.push_back({uint32_t(TrieNames.size()), uint32_t(Info.Names.size()),
+                    uint32_t(Info.Qualified)});
+    for (StringRef Name : Info.Names)
+      TrieNames.push_back(ST.add(Name));
+  }
+  std::vector<std::pair<uint32_t, uint32_t>> FileNames;
+  for (const std::string& File : Files)
+    FileNames.push_back(ST.add(File));
+
+  // Lay out the sections after the header.
+  uint64_t Offset = sizeof(Header);
+  auto Place = [&Offset] (uint64_t Count, uint64_t Size) -> Section {
+    Section S;
+    S.Offset = uint32_t(Offset);
+    S.Count = uint32_t(Count);
+    Offset = alignTo(Offset + Count * Size, 4);
+    return S;
+  };
+  Header H;
+  std::memcpy(H.Magic, kMagic.data(), sizeof(H.Magic));
+  H.Version = kVersion;
+  H.Strings = Place(ST.data().size(), 1);
+  H.Patterns = Place(Patterns.size(), sizeof(PatternRec));
+  H.Tokens = Place(Tokens.size(), sizeof(TokenRec));
+  H.Basetrie = Place(Trie.size(), sizeof(TrieRec));
+  H.TrieNames = Place(TrieNames.size(), sizeof(StringRec));
+  H.Files = Place(FileNames.size(), sizeof(StringRec));
+  if (Offset > UINT32_MAX)
+    return MakeError("the config is too large to compile");
+  H.Size = uint32_t(Offset);
+
+  support::endian::Writer W(OS, llvm::endianness::little);
+  uint64_t Written = 0;
+  auto Write32 = [&] (uint32_t V) {
+    W.write<uint32_t>(V);
+    Written += 4;
+  };
+  auto Pad = [&] {
+    for (; Written % 4 != 0; ++Written)
+      OS << '\0';
+  };
+  OS.write(H.Magic, sizeof(H.Magic));
+  Written += sizeof(H.Magic);
+  Write32(H.Version);
+  Write32(H.Size);
+  for (const Section& S : {H.Strings, H.Patterns, H.Tokens, H.Basetrie,
+                           H.TrieNames, H.Files}) {
+    Write32(S.Offset);
+    Write32(S.Count);
+  }
+  OS << ST.data();
+  Written += ST.data().size();
+  Pad();
+  for (const auto& Rec : Patterns)
+    for (uint32_t V : Rec)
+      Write32(V);
+  for (const auto& Rec : Tokens)
+    for (uint32_t V : Rec)
+      Write32(V);
+  for (const auto& Rec : Trie)
+    for (uint32_t V : Rec)
+      Write32(V);
+  for (auto [Off, Size] : TrieNames) {
+    Write32(Off);
+    Write32(Size);
+  }
+  for (auto [Off, Size] : FileNames) {
+    Write32(Off);
+    Write32(Size);
+  }
+  assert(Written == H.Size && "Layout doesn't match what was written!");
+  return Error::success();
+}
+
+//===----------------------------------------------------------------------===//
+// Loading
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// Bounds checked views into a mapped image.
+class ImageReader {
+  StringRef Image;
+  StringRef Strings;
+public:
+  explicit ImageReader(StringRef Image) : Image(Image) {}
+
+  const Header* header() const {
+    return reinterpret_cast<const Header*>(Image.data());
+  }
+
+  template <typename RecT>
+  Expected<ArrayRef<RecT>> get(const Section& S) const {
+    const uint64_t End = uint64_t(S.Offset) + uint64_t(S.Count) * sizeof(RecT);
+    if (End > Image.size())
+      return MakeError("section is out of bounds");
+    return ArrayRef(reinterpret_cast<const RecT*>(Image.data() + S.Offset),
+                    size_t(S.Count));
+  }
+
+  Error setStrings(const Section& S) {
+    Expected<ArrayRef<char>> StrOrErr = get<char>(S);
+    if (!StrOrErr)
+      return StrOrErr.takeError();
+    Strings = StringRef(StrOrErr->data(), StrOrErr->size());
+    return Error::success();
+  }
+
+  /// Returns the string at `Offset`, which must be null terminated.
+  Expected<StringRef> getString(uint32_t Offset, uint32_t Size) const {
+    if (uint64_t(Offset) + Size >= Strings.size() || Strings[Offset + Size])
+      return MakeError("string is out of bounds");
+    return Strings.substr(Offset, Size);
+  }
+  Expected<StringRef> getString(const StringRec& R) const {
+    return getString(R.Offset, R.Size);
+  }
+};
+} // namespace `anonymous`
+
+/// Decodes the token in `R`, pointing into the image.
+static Expected<Pattern::Token> DecodeToken(const ImageReader& Reader,
+                                            const TokenRec& R) {
+  using Token = Pattern::Token;
+  if (R.Kind == Token::KUnknown || R.Kind > Token::KRegexFmt)
+    return MakeError("invalid token kind");
+  Token Tok;
+  Tok.kind = Token::Kind(uint32_t(R.Kind));
+  Tok.size = R.Size;
+  Tok.trailing = R.Bits & Token::kMaxTrailing;
+  Tok.grouped = (R.Bits >> 3) & 1;
+  Tok.modified = (R.Bits >> 4) & 1;
+  switch (uint32_t(R.Data)) {
+  case TD_Null:
+    Tok.data = nullptr;
+    break;
+  case TD_Stem:
+    Tok.data = Token::kStem;
+    break;
+  case TD_Dir:
+    Tok.data = Token::kDir;
+    break;
+  case TD_Ext:
+    Tok.data = Token::kExt;
+    break;
+  default: {
+    Expected<StringRef> S = Reader.getString(R.Data, R.Size);
+    if (!S)
+      return S.takeError();
+    Tok.data = S->data();
+  }
+  }
+  return Tok;
+}
+
+Error SymbolMatcher::loadCompiledConfig(std::unique_ptr<MemoryBuffer> Image,
+                                        SmallVectorImpl<std::string>* OutFiles) {
+  StringRef Filename = Image->getBufferIdentifier();
+  auto Report = [&] (Error E) {
+    return MakeError("In " + Filename + ": " + toString(std::move(E)));
+  };
+  ImageReader Reader(Image->getBuffer());
+  if (Image->getBufferSize() < sizeof(Header))
+    return Report(MakeError("truncated header"));
+  const Header& H = *Reader.header();
+  if (H.Version != kVersion)
+    return Report(MakeError("unsupported version " + Twine(uint32_t(H.Version))
+                            + ", run --compile-config again"));
+  if (H.Size != Image->getBufferSize())
+    return Report(MakeError("truncated image"));
+  if (Error E = Reader.setStrings(H.Strings))
+    return Report(std::move(E));
+
+  auto PatternsOrErr = Reader.get<PatternRec>(H.Patterns);
+  if (!PatternsOrErr)
+    return Report(PatternsOrErr.takeError());
+  auto TokensOrErr = Reader.get<TokenRec>(H.Tokens);
+  if (!TokensOrErr)
+    return Report(TokensOrErr.takeError());
+  SmallVector<Pattern::Token> Toks;
+  for (const PatternRec& R : *PatternsOrErr) {
+    Expected<StringRef> Source = Reader.getString(R.Source);
+    if (!Source)
+      return Report(Source.takeError());
+    if (uint64_t(R.FirstToken) + R.NumTokens > TokensOrErr->size())
+      return Report(MakeError("tokens are out of bounds"));
+    Toks.clear();
+    for (const TokenRec& TR : TokensOrErr->slice(R.FirstToken, R.NumTokens)) {
+      Expected<Pattern::Token> Tok = DecodeToken(Reader, TR);
+      if (!Tok)
+        return Report(Tok.takeError());
+      Toks.push_back(*Tok);
+    }
+    auto [It, DidEmplace] = PatternMappings.try_emplace(*Source, nullptr);
+    if (!DidEmplace)
+      continue;
+    Expected<Pattern*> POrErr = compilePatternImpl(Toks);
+    if (!POrErr) {
+      PatternMappings.erase(It);
+      return Report(POrErr.takeError());
+    }
+    It->second = *POrErr;
+    if (Recorded)
+      Recorded->Patterns.push_back({It->first(), {Toks.begin(), Toks.end()}});
+    if (R.Flags & PF_Ctor)
+      CtorPatterns.insert(*POrErr);
+    if (R.Flags & PF_Dtor)
+      DtorPatterns.insert(*POrErr);
+  }
+
+  auto TrieOrErr = Reader.get<TrieRec>(H.Basetrie);
+  if (!TrieOrErr)
+    return Report(TrieOrErr.takeError());
+  auto TrieNamesOrErr = Reader.get<StringRec>(H.TrieNames);
+  if (!TrieNamesOrErr)
+    return Report(TrieNamesOrErr.takeError());
+  SmallVector<StringRef, 4> Names;
+  for (const TrieRec& R : *TrieOrErr) {
+    if (uint64_t(R.FirstName) + R.NumNames > TrieNamesOrErr->size())
+      return Report(MakeError("basetrie is out of bounds"));
+    Names.clear();
+    for (const StringRec& SR : TrieNamesOrErr->slice(R.FirstName, R.NumNames)) {
+      Expected<StringRef> Name = Reader.getString(SR);
+      if (!Name)
+        return Report(Name.takeError());
+      Names.push_back(*Name);
+    }
+    if (Recorded)
+      Recorded->Basetrie.push_back({bool(R.Qualified),
+                                    {Names.begin(), Names.end()}});
+    if (!BaseTrie)
+      BaseTrie.emplace();
+    if (R.Qualified)
+      BaseTrie->addExact(Names);
+    else
+      BaseTrie->addSuffix(Names);
+  }
+
+  if (OutFiles) {
+    auto FilesOrErr = Reader.get<StringRec>(H.Files);
+    if (!FilesOrErr)
+      return Report(FilesOrErr.takeError());
+    for (const StringRec& SR : *FilesOrErr) {
+      Expected<StringRef> File = Reader.getString(SR);
+      if (!File)
+        return Report(File.takeError());
+      // Paths were resolved when compiling, but may have gone since.
+      bool IsFile = true;
+      if (auto EC = sys::fs::is_regular_file(*File, IsFile))
+        return createFileError(*File, EC);
+      if (IsFile)
+        OutFiles->emplace_back(File->str());
+      else if (!Permissive)
+        return Report(MakeError("file \"" + *File + "\" is not a regular file"));
+    }
+  }
+
+  // Everything loaded points into the image.
+  ConfigImage = std::move(Image);
+  return Error::success();
+}
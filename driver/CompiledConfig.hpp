@@ -0,0 +1,132 @@
+//===- driver/CompiledConfig.hpp ------------------------------------------===//
+//
+// Copyright (C) 2026 Ninefold
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file defines the layout of compiled configs, written by
+/// `--compile-config`. Every field is little endian and unaligned, so the
+/// image is used in place once mapped. Offsets are from the image start.
+///
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Endian.h"
+#include "LLVM.hpp"
+#include "PatternLex.hpp"
+#include "SymbolMatcher.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace debase_tool {
+
+/// The lexed config, as it was loaded.
+struct SymbolMatcher::ConfigRecord {
+  struct PatternInfo {
+    /// The pattern source, owned by `PatternMappings`.
+    StringRef Source;
+    SmallVector<Pattern::Token, 4> Tokens;
+  };
+  struct TrieInfo {
+    bool Qualified = false;
+    SmallVector<StringRef, 4> Names;
+  };
+  std::vector<PatternInfo> Patterns;
+  std::vector<TrieInfo> Basetrie;
+};
+
+namespace compiled_config {
+
+using llvm::support::ulittle32_t;
+
+/// Can never start a JSON document.
+inline constexpr StringLiteral kMagic("\x7F" "DBCFG\r\n");
+/// Bumped whenever the layout or token kinds change.
+inline constexpr uint32_t kVersion = 1;
+
+/// An array of `Count` records.
+struct Section {
+  ulittle32_t Offset;
+  ulittle32_t Count;
+};
+
+struct Header {
+  char Magic[8];
+  ulittle32_t Version;
+  /// The size of the whole image.
+  ulittle32_t Size;
+  /// Null terminated strings, `Count` is in bytes.
+  Section Strings;
+  Section Patterns;  ///< `PatternRec`
+  Section Tokens;    ///< `TokenRec`
+  Section Basetrie;  ///< `TrieRec`
+  Section TrieNames; ///< `StringRec`
+  Section Files;     ///< `StringRec`
+};
+
+/// A string from `Header::Strings`.
+struct StringRec {
+  ulittle32_t Offset;
+  ulittle32_t Size;
+};
+
+enum PatternFlags : uint32_t {
+  PF_Ctor = 1u << 0,
+  PF_Dtor = 1u << 1,
+};
+
+struct PatternRec {
+  StringRec Source;
+  ulittle32_t FirstToken;
+  ulittle32_t NumTokens;
+  /// `PatternFlags`
+  ulittle32_t Flags;
+};
+
+/// Token data which isn't in the string table.
+enum TokenData : uint32_t {
+  TD_Null = ~0u,
+  /// File properties are compared by address.
+  TD_Stem = ~0u - 1,
+  TD_Dir  = ~0u - 2,
+  TD_Ext  = ~0u - 3,
+};
+
+struct TokenRec {
+  /// `Pattern::Token::Kind`
+  ulittle32_t Kind;
+  /// A string offset, or `TokenData`.
+  ulittle32_t Data;
+  ulittle32_t Size;
+  /// `trailing | grouped << 3 | modified << 4`
+  ulittle32_t Bits;
+};
+
+struct TrieRec {
+  ulittle32_t FirstName;
+  ulittle32_t NumNames;
+  ulittle32_t Qualified;
+};
+
+/// Checks if `Buffer` holds a compiled config.
+inline bool IsCompiledConfig(StringRef Buffer) {
+  return Buffer.starts_with(kMagic);
+}
+
+} // namespace compiled_config
+} // namespace debase_tool
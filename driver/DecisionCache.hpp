@@ -0,0 +1,75 @@
+//===- driver/DecisionCache.hpp -------------------------------------------===//
+//
+// Copyright (C) 2026 Ninefold
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file defines the DecisionCache class, which stores the results of
+/// classifying and matching symbols so they can be reused between modules.
+///
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "LLVM.hpp"
+#include "NameClassifier.hpp"
+#include "llvm/ADT/StringMap.h"
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+
+namespace debase_tool {
+
+/// What was decided for a single symbol.
+struct SymbolDecision {
+  SymbolKind Kind = SymbolKind::Invalid;
+  int8_t Variant = -1;
+  /// If the symbol was matched by the `SymbolMatcher`.
+  bool Matched = false;
+};
+
+/// A cache of decisions keyed by mangled name, shared between all modules.
+/// Safe to use from multiple threads at once.
+class DecisionCache {
+  mutable std::shared_mutex Lock;
+  llvm::StringMap<SymbolDecision> Map;
+
+public:
+  /// Returns the decision for `Sym`, if one has been made.
+  std::optional<SymbolDecision> lookup(StringRef Sym) const {
+    std::shared_lock Guard(Lock);
+    auto It = Map.find(Sym);
+    if (It == Map.end())
+      return std::nullopt;
+    return It->second;
+  }
+
+  /// Records the decision for `Sym`. Results are deterministic, so an
+  /// existing decision is never replaced.
+  void insert(StringRef Sym, SymbolDecision D) {
+    std::unique_lock Guard(Lock);
+    Map.try_emplace(Sym, D);
+  }
+
+  /// Returns the amount of symbols cached.
+  unsigned size() const {
+    std::shared_lock Guard(Lock);
+    return Map.size();
+  }
+};
+
+} // namespace debase_tool
@@ -19,35 +19,57 @@
 #include "Shared.hpp"
 #include "ArchiveHandler.hpp"
 #include "FilePropertyCache.hpp"
-#include "LLVMTargets.hpp"
+#include "IOPipeline.hpp"
 #include "Magic.hpp"
+#include "MatcherCache.hpp"
+#include "ModuleCache.hpp"
+#include "ModuleStats.hpp"
+#include "ModuleSymbols.hpp"
 #include "NameClassifier.hpp"
+#include "PhaseTimer.hpp"
+#include "Server.hpp"
+#include "DecisionCache.hpp"
 #include "SymbolFeatures.hpp"
 #include "SymbolMatcher.hpp"
+#include "TargetCache.hpp"
+#include "TargetInit.hpp"
 #include "Pattern.hpp"
 #include "Triple.hpp"
 #include "UniqueStringVector.hpp"
 // General LLVM
 #include "llvm/InitializePasses.h"
 #include "llvm/PassRegistry.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallBitVector.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/Demangle/Demangle.h"
+#include "llvm/Support/BLAKE3.h"
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/Option/OptTable.h"
 #include "llvm/Option/Option.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Object/ArchiveWriter.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/SmallVectorMemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/WithColor.h"
 #include "llvm/Support/raw_ostream.h"
 // Target related
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/CodeGen/TargetPassConfig.h"
+#include "llvm/IR/LegacyPassManager.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/TargetParser/Host.h"
 #include "llvm/TargetParser/SubtargetFeature.h"
@@ -58,11 +80,17 @@
 #include "llvm/IR/Verifier.h"
 #include "llvm/Passes/PassBuilder.h"
 #include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Analysis/InlineCost.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/InstCombine/InstCombine.h"
-#include "llvm/Transforms/Utils/Debugify.h"
+#include "llvm/Transforms/Scalar/DeadStoreElimination.h"
+#include "llvm/Transforms/Scalar/SROA.h"
+#include "llvm/Transforms/Scalar/SimplifyCFG.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 // Miscellaneous
 #include <debase/Config.hpp>
+#include <atomic>
+#include <deque>
 #include <memory>
 #include <optional>
 #include <string>
@@ -90,6 +118,7 @@ static codegen::RegisterCodeGenFlags CFG;
 bool debase_tool::Strict = false;
 bool debase_tool::Permissive = false;
 bool debase_tool::Verbose = false;
+std::atomic<bool>* debase_tool::RequestFailed = nullptr;
 
 enum HardeningMode {
   strict,
@@ -97,6 +126,11 @@ enum HardeningMode {
   permissive,
 };
 
+enum VerifyScopeMode {
+  scope_module,
+  scope_function,
+};
+
 cl::OptionCategory debase_tool::DebaseToolCategory("Debaser Options");
 
 namespace debase_tool {
@@ -106,10 +140,22 @@ InputFilenames(cl::Positional,
                cl::desc("<input files...>"),
                cl::cat(DebaseToolCategory));
 
+static cl::list<std::string>
+ConfigFiles("config",
+            cl::desc("Config file, given more than once to debase the "
+                     "inputs for each (in a directory of -o named after it)"),
+            cl::value_desc("config"), cl::cat(DebaseToolCategory));
+
+/// The first `--config`, which is the only one without fan-out.
+static StringRef GetConfigFile() {
+  return ConfigFiles.empty() ? StringRef() : StringRef(ConfigFiles.front());
+}
+
 static cl::opt<std::string>
-ConfigFile("config",
-           cl::desc("Config file"), cl::value_desc("config"),
-           cl::cat(DebaseToolCategory));
+CompileConfigOut("compile-config",
+                 cl::desc("Write --config as an image which loads without "
+                          "parsing, then exit"),
+                 cl::value_desc("file"), cl::cat(DebaseToolCategory));
 
 static cl::opt<std::string>
 OutputFilepath("o",
@@ -165,7 +211,9 @@ EmitAll("emit-all", cl::Hidden,
         cl::init(false), cl::cat(DebaseToolCategory));
 
 static std::optional<std::string> ArchiveOnly;
+static std::optional<std::string> EmitArchive;
 static std::optional<std::string> OutputSuccessfulFilenames;
+static std::optional<std::string> StatsFilename;
 
 // The ArchiveOnly cl option
 static cl::opt<std::string>
@@ -180,6 +228,44 @@ ArchiveOnlyOpt(
       ArchiveOnly.emplace("out.a");
   }));
 
+static cl::opt<unsigned>
+ContextModuleLimit("context-modules",
+                   cl::desc("Modules loaded into an LLVMContext before it's "
+                            "recreated (0 for no limit)"),
+                   cl::init(0), cl::cat(DebaseToolCategory));
+
+static cl::opt<unsigned>
+ContextMBLimit("context-mb",
+               cl::desc("Megabytes of input loaded into an LLVMContext "
+                        "before it's recreated (0 for no limit)"),
+               cl::init(512), cl::cat(DebaseToolCategory));
+
+static cl::opt<unsigned>
+IODepth("io-depth",
+        cl::desc("Modules read ahead of and written behind the workers "
+                 "(0 does I/O inline)"),
+        cl::init(4), cl::cat(DebaseToolCategory));
+
+static cl::opt<bool>
+ThinArchive("thin-archive",
+            cl::desc("Make --archive-only reference the input files instead "
+                     "of copying them"),
+            cl::init(false), cl::cat(DebaseToolCategory));
+
+// The EmitArchive cl option
+static cl::opt<std::string>
+EmitArchiveOpt(
+  "emit-archive",
+  cl::desc("Write the outputs into an archive with a symbol table, "
+           "instead of separate files"),
+  cl::cat(DebaseToolCategory), cl::ValueOptional,
+  cl::callback([] (const std::string& ArchiveName) {
+    if (!ArchiveName.empty())
+      EmitArchive.emplace(ArchiveName);
+    else
+      EmitArchive.emplace("out.a");
+  }));
+
 // The OutputSuccessfulFilenames cl option
 static cl::opt<std::string>
 OutputSuccessfulFilenamesOpt(
@@ -193,6 +279,59 @@ OutputSuccessfulFilenamesOpt(
       OutputSuccessfulFilenames.emplace("out.json");
   }));
 
+// The StatsFilename cl option
+static cl::opt<std::string>
+StatsFilenameOpt(
+  "stats-json",
+  cl::desc("Output statistics for each module"),
+  cl::cat(DebaseToolCategory), cl::ValueOptional,
+  cl::callback([] (const std::string& OName) {
+    if (!OName.empty())
+      StatsFilename.emplace(OName);
+    else
+      StatsFilename.emplace("stats.json");
+  }));
+
+static cl::opt<unsigned>
+NumThreads("j", cl::Prefix,
+           cl::desc("Number of modules to debase in parallel "
+                    "(0 uses all cores)"),
+           cl::value_desc("N"), cl::init(1),
+           cl::cat(DebaseToolCategory));
+
+static cl::opt<std::string>
+Serve("serve", cl::ValueOptional,
+      cl::desc("Run requests from stdin, or the local socket <path>, "
+               "keeping targets and configs loaded between them"),
+      cl::value_desc("path"), cl::cat(DebaseToolCategory));
+
+static cl::opt<bool>
+TimePhases("time-phases",
+           cl::desc("Print the time spent in each phase"),
+           cl::cat(DebaseToolCategory));
+
+static cl::opt<std::string>
+TraceOut("trace-out",
+         cl::desc("Write a Chrome trace with a span for each module"),
+         cl::value_desc("file"), cl::cat(DebaseToolCategory));
+
+static cl::opt<unsigned>
+TraceGranularity("trace-granularity", cl::Hidden,
+                 cl::desc("Minimum microseconds for a span to be traced"),
+                 cl::init(0), cl::cat(DebaseToolCategory));
+
+static cl::opt<bool>
+StreamArchives("stream-archives",
+               cl::desc("Debase archive members as they are read, instead of "
+                        "after all other inputs"),
+               cl::cat(DebaseToolCategory));
+
+static cl::opt<std::string>
+CacheDir("cache-dir",
+         cl::desc("Reuse modules debased by previous runs, storing new ones "
+                  "in this folder"),
+         cl::value_desc("folder"), cl::cat(DebaseToolCategory));
+
 static cl::opt<bool>
 NoXArchives("no-archives",
             cl::desc("Disallow archive loading"),
@@ -206,6 +345,30 @@ OutputAssembly("output-assembly",
                cl::desc("Output LLVM assembly instead of bitcode"),
                cl::cat(DebaseToolCategory));
 
+static cl::opt<bool>
+Cleanup("cleanup",
+        cl::desc("Simplify debased functions and their direct callers, "
+                 "inlining anything made trivial"),
+        cl::cat(DebaseToolCategory));
+
+static cl::opt<bool>
+StripDead("strip-dead",
+          cl::desc("Remove local functions and globals left unused after "
+                   "debasing"),
+          cl::cat(DebaseToolCategory));
+
+static cl::opt<bool>
+EmitObj("emit-obj",
+        cl::desc("Run codegen in-process, writing object files instead of "
+                 "bitcode (or assembly with --output-assembly)"),
+        cl::cat(DebaseToolCategory));
+
+static cl::opt<char>
+CodeGenOptLevelO("O",
+                 cl::desc("Codegen optimization level for --emit-obj. "
+                          "[-O0, -O1, -O2, or -O3] (default = '-O2')"),
+                 cl::Prefix, cl::init('2'), cl::cat(DebaseToolCategory));
+
 //static cl::opt<bool>
 //PrintPasses("print-passes",
 //            cl::desc("Print available passes and exit"),
@@ -226,6 +389,12 @@ TargetTriple("mtriple",
              cl::desc("Override target triple for module"),
              cl::cat(DebaseToolCategory));
 
+static cl::opt<bool>
+LazyBitcode("lazy-bitcode",
+            cl::desc("Only materialize the bodies of matched functions until "
+                     "the module is written"),
+            cl::cat(DebaseToolCategory));
+
 static cl::opt<bool>
 NoOutput("disable-output", cl::Hidden,
          cl::desc("Do not write result bitcode file"),
@@ -248,6 +417,20 @@ VerifyEach("verify-each",
            cl::desc("Verify after each transform"),
            cl::cat(DebaseToolCategory));
 
+static cl::opt<VerifyScopeMode>
+VerifyScope("verify-scope",
+  cl::desc("What -verify-each checks after each transform:"),
+  cl::value_desc("scope"), cl::cat(DebaseToolCategory),
+  cl::init(VerifyScopeMode::scope_module),
+  cl::values(
+    clEnumValN(scope_module,   "module",   "The whole module (default)"),
+    clEnumValN(scope_function, "function", "Only the modified functions")));
+
+static cl::opt<bool>
+VerifyFinal("verify-final",
+            cl::desc("Verify the whole module once debasing is done"),
+            cl::cat(DebaseToolCategory));
+
 static cl::opt<std::string>
 ClDataLayout("data-layout",
              cl::desc("data layout string to use"),
@@ -274,14 +457,15 @@ RunTwice("run-twice", cl::Hidden,
 }
 
 static void exitOrLogWithError(Twine Msg, std::string Hint = "") {
-  if (!Permissive)
+  if (!Permissive && !RequestFailed)
     return exitWithError(Msg, std::move(Hint));
-  // Permissive, continue!
+  // Permissive or serving, continue!
   WithColor::error(errs())
     << raw_ostream::RED << Msg 
     << "\n" << raw_ostream::RESET;
   if (!Hint.empty())
     WithColor::note(errs()) << Hint << "\n";
+  debase_tool::exitP(1);
 }
 
 template <typename DefaultT>
@@ -292,8 +476,7 @@ static decltype(auto) exitOrReturnDefault(DefaultT&& Default,
 }
 template <typename DefaultT>
 static decltype(auto) exitOrReturnDefault(DefaultT&& Default) {
-  if (!Permissive)
-    return std::exit(1);
+  debase_tool::exitP(1);
   return std::forward<DefaultT>(Default);
 }
 
@@ -390,32 +573,17 @@ static void CheckStuff() {
 }
 #endif
 
-/// Info that stays the same with every triple.
-struct CachedTargetInfo {
-  std::unique_ptr<TargetMachine> TM = nullptr;
-  TargetLibraryInfoImpl TLII;
-  DebugifyCustomPassManager Passes;
-public:
-  CachedTargetInfo(const Triple& TT,
-                   std::unique_ptr<TargetMachine> InTM)
-   : TM(std::move(InTM)), TLII(TT) {
-    //// Add TLII Pass.
-    //Passes.add(new TargetLibraryInfoWrapperPass(TLII));
-    //// Add internal analysis passes from the target machine.
-    //Passes.add(createTargetTransformInfoWrapperPass(TM ? TM->getTargetIRAnalysis()
-    //                                                   : TargetIRAnalysis()));
-    //if (TM) {
-    //  // FIXME: We should dyn_cast this when supported.
-    //  auto& LTM = static_cast<LLVMTargetMachine&>(*TM);
-    //  Passes.add(LTM.createPassConfig(Passes));
-    //}
-  }
-};
-
-/// Initializes literally everything. Might be able to pull back a bit...
-static void LLVMInitializeEverything();
-/// Gets the OptLevel of `-O1`.
-static CodeGenOptLevel GetCodeGenOptLevel() { return CodeGenOptLevel::Less; } 
+/// Gets the OptLevel from `-O`, validated in `main`.
+static CodeGenOptLevel GetCodeGenOptLevel() {
+  return CodeGenOpt::parseLevel(CodeGenOptLevelO)
+    .value_or(CodeGenOptLevel::Default);
+}
+/// Gets the extension of written modules.
+static StringRef GetOutputExtension() {
+  if (EmitObj)
+    return OutputAssembly ? ".s" : ".o";
+  return OutputAssembly ? ".ll" : ".bc";
+}
 /// Gets some basic passes we can run on functions.
 static std::vector<FunctionPass*> GetO1PassesRequiredForSimplification();
 
@@ -425,6 +593,8 @@ namespace {
 class DeBaser {
   /// The original filename.
   std::string LLFile;
+  /// The original contents, if loaded from memory.
+  std::optional<MemoryBufferRef> Source;
   /// The matcher for the current module group.
   SymbolMatcher& SM;
   /// The commandline (for diagnostics).
@@ -445,6 +615,12 @@ class DeBaser {
   std::unique_ptr<Module> M = nullptr;
   /// Used to determine the type of functions.
   Classifier* SymClassifier = nullptr;
+  /// Decisions shared with other modules, may be null.
+  DecisionCache* Decisions = nullptr;
+  /// Targets owned by the current worker, may be null.
+  TargetCache* Targets = nullptr;
+  /// Counters for `--stats-json`, may be null.
+  ModuleStats* Stats = nullptr;
   /// The map of `(ReferencedFunc*, PrevInfo)` tuples.
   SmallDenseMap<Function*, PrevFunctionInfo> LocatedRefs;
 
@@ -456,6 +632,10 @@ class DeBaser {
   Function* BI__clang_call_terminate = nullptr;
   // Holds builtins
   SmallPtrSet<Function*, 4> BISet;
+  /// Calls to builtins in each function of `LocatedRefs`.
+  SmallDenseMap<Function*, SmallVector<CallBase*, 2>> BuiltinCalls;
+  /// Functions outside of `LocatedRefs` which were modified.
+  SmallSetVector<Function*, 8> Touched;
 
   bool LoadedModule : 1 = false;
   bool SetUnlinks   : 1 = false;
@@ -463,6 +643,12 @@ class DeBaser {
   bool LastCheck    : 1 = true;
   bool DidCleanup   : 1 = false;
   bool IsOk         : 1 = true;
+  /// Anything was changed since loading.
+  bool Modified     : 1 = false;
+  /// Loading this module created its context.
+  bool CreatedContext : 1 = false;
+  /// Modules loaded into this module's context, up to and including it.
+  unsigned ContextModules = 0;
 
 public:
   /// A utility for creating new debaser objects.
@@ -473,7 +659,8 @@ public:
   }
 
   DeBaser(MemoryBufferRef IRFile, SymbolMatcher& SM, StringRef Argv0)
-    : LLFile(IRFile.getBufferIdentifier()), SM(SM), Argv0(Argv0) {
+    : LLFile(IRFile.getBufferIdentifier()), Source(IRFile),
+      SM(SM), Argv0(Argv0) {
   }
 
   ~DeBaser() {
@@ -492,6 +679,15 @@ public:
   void setNameDemangler(Classifier* C) {
     this->SymClassifier = C;
   }
+  void setDecisionCache(DecisionCache* DC) {
+    this->Decisions = DC;
+  }
+  void setTargetCache(TargetCache* TC) {
+    this->Targets = TC;
+  }
+  void setStats(ModuleStats* MS) {
+    this->Stats = MS;
+  }
 
   bool loadRefsAndBuiltins();
 
@@ -505,14 +701,32 @@ public:
       error() << "SetUnlinks is false!\n";
       return;
     }
+    PhaseScope PS(Phase::Debase);
+    // Find the markers through their uses, rather than scanning every call.
+    this->collectBuiltinCalls();
     for (auto [F, _] : LocatedRefs) {
       this->debaseFunction(F);
       DBG_STMT(F->print(errs() << '\n'));
     }
+    if (Stats) {
+      Stats->FunctionsDebased += LocatedRefs.size();
+      Stats->sampleMemory();
+    }
   }
 
+  /// Simplifies debased functions and their callers, which are left with
+  /// dead stores and empty blocks once the base calls are removed. Lazy
+  /// modules are fully materialized first, so every caller is seen.
+  bool runCleanupPasses();
+
+  /// Removes local definitions left without uses, such as base ctors/dtors
+  /// which were only called by debased functions. Lazy modules are fully
+  /// materialized first, as unread bodies don't contribute uses.
+  bool removeDeadDefinitions();
+
   /// Resets function attributes to their original state
   void resetFunctionAttrs() {
+    PhaseScope PS(Phase::ResetAttrs);
     for (auto [F, PrevInfo] : LocatedRefs)
       DeBaser::ResetInfo(F, PrevInfo);
   }
@@ -522,13 +736,21 @@ public:
     //RemoveAllReferencesTo(BI__debase_mark_begin);
     //RemoveAllReferencesTo(BI__debase_mark_end);
     //RemoveAllReferencesTo(BI__debase_continuation);
-    MakeBIRemovable(BI__debase_mark_begin);
-    MakeBIRemovable(BI__debase_mark_end);
-    MakeBIRemovable(BI__debase_continuation);
+    Modified |= MakeBIRemovable(BI__debase_mark_begin);
+    Modified |= MakeBIRemovable(BI__debase_mark_end);
+    Modified |= MakeBIRemovable(BI__debase_continuation);
   }
 
+  /// Verifies the module after `Section` when running with `-verify-each`.
   bool verify(StringRef Section = "") {
-    if (VerifyEach && verifyModule(*M, &errs())) {
+    if (!VerifyEach)
+      return true;
+    return verifyNow(Section, VerifyScope == scope_module);
+  }
+
+  /// Verifies the whole module, or only the functions which may have changed.
+  bool verifyNow(StringRef Section, bool WholeModule) {
+    if (isBroken(WholeModule)) {
       if (!Section.empty())
         error() << "'" << LLFile << "' failed during " << Section << ".\n";
       else
@@ -540,6 +762,18 @@ public:
   }
 
   ErrorOr<std::string> writeLLVM(const Twine& Dir);
+  /// Writes the module to memory, with the name of its output file.
+  std::unique_ptr<MemoryBuffer> writeLLVMToBuffer();
+
+  /// Modules loaded into this module's context, up to and including it.
+  unsigned getContextModules() const { return ContextModules; }
+  /// Records the state of the context this was loaded into.
+  void setContextInfo(unsigned NumModules) {
+    ContextModules = NumModules;
+    CreatedContext = (NumModules == 1);
+  }
+  /// Returns if loading this module created its context.
+  bool createdContext() const { return CreatedContext; }
 
   Triple getTriple() const {
     assert(M && "Module was not initialized!");
@@ -560,16 +794,26 @@ public:
 
 private:
   /// Gets a `PrevFunctionInfo` while updating the function.
-  static PrevFunctionInfo GetInfoAndUpdate(Function* F, const SymbolFeatures& FFeats);
+  static PrevFunctionInfo GetInfoAndUpdate(Function* F, SymbolKind K);
   /// Resets a `Function` using `PrevFunctionInfo`.
   static void ResetInfo(Function* F, const PrevFunctionInfo& Info);
-  /// Makes builtin always_inline
-  static void MakeBIRemovable(Function* F);
+  /// Makes builtin always_inline.
+  /// @return `true` if the attributes were changed.
+  static bool MakeBIRemovable(Function* F);
   /// Removes all uses of a function in module.
   static void RemoveAllReferencesTo(Function* F);
 
-  /// Common between both `loadModule` implementations.
-  bool loadModuleCommon(StringRef Filename);
+  /// Common between both `loadModule` implementations. `Prepared` modules
+  /// were copied from one which was already verified.
+  bool loadModuleCommon(StringRef Filename, bool Prepared = false);
+  /// Strips and verifies the input, must be fully materialized.
+  bool prepareMaterializedModule();
+  /// Materializes the rest of a lazily loaded module.
+  bool materializeModule();
+  /// Runs codegen on the module, writing an object file to `OS`.
+  bool emitObject(raw_pwrite_stream& OS);
+  /// Writes the materialized module to `OS` in the output format.
+  bool writeModule(raw_pwrite_stream& OS);
   /// Loads a `Module` from the specified file into `DeBaser::M`.
   bool loadModule(StringRef Filename, LLVMContext& Context);
   /// Loads a `Module` from the specified buffer into `DeBaser::M`.
@@ -584,6 +828,19 @@ private:
   /// Handles debasing one function.
   bool debaseDestructor(Function* F);
 
+  /// Groups the calls to builtins by the debased function containing them.
+  void collectBuiltinCalls();
+  /// Returns the calls to `BI` in `F`, in no particular order.
+  SmallVector<CallBase*, 0> getMarkers(Function* F, Function* BI);
+  /// Adds `I` to `ToRemove` if it calls a removable function.
+  /// @return `false` if the scan should stop.
+  bool scanRemovableCall(CallBase& I,
+                         SmallVectorImpl<Instruction*>& ToRemove) const;
+  /// Erases `ToRemove` and every builtin call in `F`.
+  void eraseCalls(Function* F, ArrayRef<Instruction*> ToRemove);
+  /// Adds the patterns matching the function `Name` to `Stats`.
+  void countPatternHits(StringRef Name);
+
   /// Checks if type is ctor or dtor.
   bool isConstructor(Function* F) const {
     // TODO: Change this!
@@ -591,26 +848,49 @@ private:
   }
   /// Checks if is removable
   bool isRemovableFunction(Function* F) const;
+  /// Runs the verifier on the module, or on the functions which may have
+  /// changed. Builtins are only ever declarations, so they are skipped.
+  bool isBroken(bool WholeModule) const;
 };
 
 /// A utility for creating new debaser objects.
 class DeBaser::Factory {
   SymbolMatcher& SM;
   std::string Argv0;
+  /// Types, constants and metadata are never freed, so the context is
+  /// recreated once it's held enough modules.
+  std::unique_ptr<LLVMContext> Context;
+  unsigned ContextModules = 0;
+  uint64_t ContextBytes = 0;
 public:
   Factory(SymbolMatcher& SM, const char* Argv0) :
    SM(SM), Argv0(Argv0) {}
   
-  static LLVMContext& ctx() {
-    static thread_local LLVMContext Context;
-    return Context;
+  /// Gets the context for a module of `Size` bytes. Every module from the
+  /// previous one must have been destroyed.
+  LLVMContext& ctx(uint64_t Size) {
+    const bool Full =
+      (ContextModuleLimit && ContextModules >= ContextModuleLimit) ||
+      (ContextMBLimit && ContextBytes >= uint64_t(ContextMBLimit) << 20);
+    if (!Context || Full) {
+      Context.reset();
+      Context = std::make_unique<LLVMContext>();
+      ContextModules = 0;
+      ContextBytes = 0;
+    }
+    ++ContextModules;
+    ContextBytes += Size;
+    return *Context;
   }
-  
+
   std::unique_ptr<DeBaser> New(StringRef Filename) {
     std::unique_ptr<DeBaser> DB(
         new DeBaser(Filename, SM, Argv0));
-    if (!DB->loadModule(Filename, this->ctx()))
+    uint64_t Size = 0;
+    (void) sys::fs::file_size(Filename, Size);
+    if (!DB->loadModule(Filename, this->ctx(Size)))
       return nullptr;
+    DB->setContextInfo(ContextModules);
     if (LLVM_UNLIKELY(!DB->LoadedModule)) {
       // Unfortunately, we have failed... Return nothing.
       return nullptr;
@@ -621,14 +901,89 @@ public:
   std::unique_ptr<DeBaser> From(MemoryBufferRef IRFile) {
     std::unique_ptr<DeBaser> DB(
         new DeBaser(IRFile, SM, Argv0));
-    if (!DB->loadModule(IRFile, this->ctx()))
+    if (!DB->loadModule(IRFile, this->ctx(IRFile.getBufferSize())))
       return nullptr;
+    DB->setContextInfo(ContextModules);
     if (LLVM_UNLIKELY(!DB->LoadedModule)) {
       // Unfortunately, we have failed... Return nothing.
       return nullptr;
     }
     return DB;
   }
+
+  /// Copies the module of `Other` before it's debased, for this factory's
+  /// matcher. The copy shares its context, so it can't outlive `Other`.
+  std::unique_ptr<DeBaser> Clone(DeBaser& Other) {
+    if (!Other.materializeModule())
+      return nullptr;
+    std::unique_ptr<DeBaser> DB(
+        new DeBaser(Other.LLFile, SM, Argv0));
+    {
+      PhaseScope PS(Phase::Parse);
+      DB->M = CloneModule(*Other.M);
+    }
+    if (!DB->loadModuleCommon(DB->M->getSourceFileName(), /*Prepared=*/true))
+      return nullptr;
+    DB->Modified = Other.Modified;
+    // The copy lives in the context of `Other`, which already created it.
+    DB->ContextModules = Other.ContextModules;
+    return DB;
+  }
+};
+
+/// The state owned by a single debasing thread.
+struct DebaseWorker {
+  /// The matcher for this worker, updated by `setFilename` for each module.
+  SymbolMatcher& SM;
+  DeBaser::Factory Factory;
+  ItaniumClassifier IClass;
+  MSVCClassifier MClass;
+  /// Decisions shared by every worker.
+  DecisionCache* Decisions;
+  /// Targets for this worker, `TargetMachine`s can't be shared.
+  TargetCache Targets;
+  /// The last module written with `--emit-archive`.
+  std::unique_ptr<MemoryBuffer> Written;
+  /// Where the modules for this worker's config are written.
+  std::string OutputDir;
+public:
+  DebaseWorker(SymbolMatcher& SM, const char* Argv0, DecisionCache* DC,
+               StringRef OutputDir)
+   : SM(SM), Factory(SM, Argv0), Decisions(DC),
+     Targets(GetCodeGenOptLevel()), OutputDir(OutputDir) {}
+};
+
+/// A module queued for debasing.
+struct ModuleJob {
+  /// The name used for diagnostics.
+  StringRef Filename;
+  /// The module contents, if not loaded from `Filename`.
+  std::optional<MemoryBufferRef> Data;
+  /// An archive streamed member by member, released once finished.
+  std::unique_ptr<MemoryBuffer> Archive = nullptr;
+  /// The configs which list this module, indexed like the workers.
+  SmallBitVector Configs;
+};
+
+/// What the symbol table of a module says about it.
+struct ModuleScan {
+  /// The amount of `__debase_*` builtins referenced.
+  unsigned BICount = 0;
+  /// Both markers are referenced, so the module can be debased.
+  bool HasMarkers = false;
+  /// Some symbol may be accepted by the matcher.
+  bool MayMatch = false;
+  /// `MayMatch` for each config scanned.
+  SmallVector<bool, 1> MayMatchIn;
+public:
+  /// The module will be written unchanged.
+  bool isUntouched() const {
+    return BICount == 0 && !MayMatch;
+  }
+  /// The module will be written unchanged for config `K`.
+  bool isUntouchedIn(unsigned K) const {
+    return BICount == 0 && !MayMatchIn[K];
+  }
 };
 
 } // namespace `anonymous`
@@ -675,11 +1030,158 @@ void DeBaser::runPasses(const std::vector<FunctionPass*>& Passes, StringRef Pass
     }
   }
 
-  if (VerifyEach && verifyModule(*M, &errs())) {
+  if (VerifyEach && isBroken(VerifyScope == scope_module)) {
     error() << PassName << " pass is broken!\n";
   }
 }
 
+bool DeBaser::isBroken(bool WholeModule) const {
+  PhaseScope PS(Phase::Verify);
+  if (WholeModule)
+    return verifyModule(*M, &errs());
+  bool Broken = false;
+  auto Verify = [&Broken] (Function* F) {
+    if (!F->isDeclaration() && verifyFunction(*F, &errs()))
+      Broken = true;
+  };
+  for (auto [F, _] : LocatedRefs)
+    Verify(F);
+  for (Function* F : Touched)
+    Verify(F);
+  return Broken;
+}
+
+bool DeBaser::removeDeadDefinitions() {
+  if (!materializeModule())
+    return false;
+  PhaseScope PS(Phase::StripDead);
+  const DataLayout& DL = M->getDataLayout();
+  unsigned NumFunctions = 0, NumInstructions = 0, NumGlobals = 0;
+  uint64_t GlobalBytes = 0;
+  // Comdats are kept or discarded as a group, leave those to the linker.
+  auto IsDead = [] (GlobalValue& GV) {
+    if (!GV.hasLocalLinkage() || GV.hasComdat() || GV.isDeclaration())
+      return false;
+    GV.removeDeadConstantUsers();
+    return GV.use_empty();
+  };
+
+  // Removing a definition can free anything it referenced, so repeat.
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    for (Function& F : llvm::make_early_inc_range(*M)) {
+      if (!IsDead(F))
+        continue;
+      NumInstructions += F.getInstructionCount();
+      ++NumFunctions;
+      LocatedRefs.erase(&F);
+      Touched.remove(&F);
+      F.eraseFromParent();
+      Changed = true;
+    }
+    for (GlobalVariable& GV : llvm::make_early_inc_range(M->globals())) {
+      if (!IsDead(GV))
+        continue;
+      GlobalBytes += DL.getTypeAllocSize(GV.getValueType());
+      ++NumGlobals;
+      GV.eraseFromParent();
+      Changed = true;
+    }
+  }
+
+  if (Stats) {
+    Stats->InstructionsErased += NumInstructions;
+    Stats->DeadFunctions += NumFunctions;
+    Stats->DeadGlobals += NumGlobals;
+    Stats->DeadGlobalBytes += GlobalBytes;
+  }
+  if (NumFunctions == 0 && NumGlobals == 0)
+    return true;
+  this->Modified = true;
+  WithColor::remark(vbss())
+    << "Removed " << NumFunctions << " dead functions (" << NumInstructions
+    << " instructions) and " << NumGlobals << " dead globals (" << GlobalBytes
+    << " bytes) from '" << LLFile << "'.\n";
+  return true;
+}
+
+/// Functions at most this size are inlined into their callers after cleanup.
+static constexpr unsigned kTrivialInstructionCount = 16;
+
+bool DeBaser::runCleanupPasses() {
+  if (!materializeModule())
+    return false;
+  PhaseScope PS(Phase::Cleanup);
+  LoopAnalysisManager LAM;
+  FunctionAnalysisManager FAM;
+  CGSCCAnalysisManager CGAM;
+  ModuleAnalysisManager MAM;
+  PassBuilder PB;
+  PB.registerModuleAnalyses(MAM);
+  PB.registerCGSCCAnalyses(CGAM);
+  PB.registerFunctionAnalyses(FAM);
+  PB.registerLoopAnalyses(LAM);
+  PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+  FunctionPassManager FPM;
+  FPM.addPass(SROAPass(SROAOptions::ModifyCFG));
+  FPM.addPass(InstCombinePass());
+  FPM.addPass(SimplifyCFGPass());
+  FPM.addPass(DSEPass());
+  FPM.addPass(SimplifyCFGPass());
+
+  auto RunOn = [&] (Function& F) {
+    // Respect -O0 and friends.
+    if (F.isDeclaration() || F.hasOptNone())
+      return;
+    FAM.invalidate(F, PreservedAnalyses::none());
+    const unsigned Before = Stats ? F.getInstructionCount() : 0;
+    FPM.run(F, FAM);
+    // Inlining can grow callers, so only count what shrank.
+    if (Stats && F.getInstructionCount() < Before)
+      Stats->InstructionsErased += Before - F.getInstructionCount();
+  };
+
+  // Walk in module order, so the output doesn't depend on pointer values.
+  SmallSetVector<Function*, 8> Callers;
+  for (Function& Ref : *M) {
+    Function* F = &Ref;
+    if (!LocatedRefs.contains(F))
+      continue;
+    RunOn(*F);
+    const bool IsTrivial = F->size() == 1
+      && F->getInstructionCount() <= kTrivialInstructionCount
+      && F->hasExactDefinition() && !F->hasFnAttribute(Attribute::NoInline)
+      && isInlineViable(*F).isSuccess();
+    SmallVector<CallBase*, 4> Calls;
+    for (User* U : F->users()) {
+      auto* CB = dyn_cast<CallBase>(U);
+      if (CB && CB->getCalledFunction() == F)
+        Calls.push_back(CB);
+    }
+    for (CallBase* CB : Calls) {
+      Function* Caller = CB->getFunction();
+      if (Caller == F)
+        continue;
+      Callers.insert(Caller);
+      if (!LocatedRefs.contains(Caller))
+        Touched.insert(Caller);
+      if (!IsTrivial || CB->isNoInline() || Caller->hasOptNone())
+        continue;
+      InlineFunctionInfo IFI;
+      if (InlineFunction(*CB, IFI).isSuccess())
+        vbss() << "Inlined " << F->getName() << " into "
+               << Caller->getName() << '\n';
+    }
+  }
+  for (Function* Caller : Callers)
+    RunOn(*Caller);
+  if (Stats)
+    Stats->sampleMemory();
+  return true;
+}
+
 bool DeBaser::debaseFunction(Function* F) {
   DBG_STMT(
     errs() << "\n\n" << llvm::demangle(F->getName()) << ": "
@@ -716,37 +1218,58 @@ static void PrintCall(CallBase& I, int type) {
   }
 }
 
-static void IterateInstructions(Function* F, function_ref<bool(CallBase&)> CB) {
+/// Calls `CB` on each call from the start of `F` up to `End`, or to the end
+/// of `F` if null. Stops early if `CB` returns false.
+static void IterateCallsBefore(Function* F, Instruction* End,
+                               function_ref<bool(CallBase&)> CB) {
   for (BasicBlock& BB : *F) {
-#if DO_DBG_STMT
-    {
-      WithColor OS(errs());
-      bool IsEntryBlock = BB.getParent() && BB.isEntryBlock();
-      if (BB.hasName()) {
-        OS << raw_ostream::CYAN << '\n' << BB.getName() << ":\n";
-      } else if (!IsEntryBlock) {
-        OS << '\n';
-        //int Slot = Machine.getLocalSlot(BB);
-        //if (Slot != -1)
-        //  OS << Slot << ":\n";
-        //else
-        //  OS << "<badref>:\n";
-        OS << "*:\n";
-      }
-    }
-#endif
     for (Instruction& I : BB) {
-      if (!isa<CallBase>(I)) {
-        DBG_STMT(I.print(errs() << '\n'));
-        continue;
-      }
-      // CallBase
-      if (!CB(cast<CallBase>(I)))
+      if (&I == End)
         return;
+      if (auto* Call = dyn_cast<CallBase>(&I))
+        if (!CB(*Call))
+          return;
+    }
+  }
+}
+
+/// Calls `CB` on each call after `Begin` in its function.
+/// Stops early if `CB` returns false.
+static void IterateCallsAfter(Instruction* Begin,
+                              function_ref<bool(CallBase&)> CB) {
+  Function* F = Begin->getFunction();
+  BasicBlock* BB = Begin->getParent();
+  auto I = std::next(Begin->getIterator());
+  while (true) {
+    for (auto E = BB->end(); I != E; ++I) {
+      if (auto* Call = dyn_cast<CallBase>(&*I))
+        if (!CB(*Call))
+          return;
     }
+    auto Next = std::next(BB->getIterator());
+    if (Next == F->end())
+      return;
+    BB = &*Next;
+    I = BB->begin();
   }
 }
 
+/// Returns the first of `Calls` in block layout order.
+static CallBase* GetFirstInLayout(ArrayRef<CallBase*> Calls) {
+  if (Calls.size() <= 1)
+    return Calls.empty() ? nullptr : Calls.front();
+  Function* F = Calls.front()->getFunction();
+  SmallDenseMap<const BasicBlock*, unsigned, 16> Order;
+  unsigned Ix = 0;
+  for (BasicBlock& BB : *F)
+    Order[&BB] = Ix++;
+  return *llvm::min_element(Calls, [&](CallBase* LHS, CallBase* RHS) {
+    if (LHS->getParent() != RHS->getParent())
+      return Order[LHS->getParent()] < Order[RHS->getParent()];
+    return LHS->comesBefore(RHS);
+  });
+}
+
 bool DeBaser::isRemovableFunction(Function* F) const {
   //errs() << raw_ostream::RESET << "\n*" << F->getName() << "*\n";
   if (F == BI__clang_call_terminate)
@@ -764,104 +1287,118 @@ bool DeBaser::isRemovableFunction(Function* F) const {
     return true;
 }
 
-bool DeBaser::debaseConstructor(Function* F) {
-  Instruction* Begin = nullptr;
-  //Instruction* Continue = nullptr;
-  SmallPtrSet<Instruction*, 32> ToRemove;
-
-  auto ScanFunc = [&, this] (CallBase& I) -> bool {
-    Function* IDest = I.getCalledFunction();
-    if (!IDest) {
-      if (!I.isIndirectCall())
-        return false;
-      DBG_STMT(I.print(errs() << '\n'));
-      return true;
-    }
-    // Check if this is a __debase pseudofunction
-    if (BISet.contains(IDest)) {
-      // Check which one it is :)
-      if (BI__debase_mark_begin == IDest) {
-        if (!Begin)
-          Begin = &I;
-        // We don't exit here so we can remove all builtins
-      }
-      DBG_STMT(PrintCall(I, 2));
-      ToRemove.insert(&I);
-      return true;
+void DeBaser::collectBuiltinCalls() {
+  BuiltinCalls.clear();
+  for (Function* BI : BISet) {
+    for (User* U : BI->users()) {
+      auto* I = dyn_cast<CallBase>(U);
+      if (!I || I->getCalledFunction() != BI)
+        continue;
+      Function* F = I->getFunction();
+      if (LocatedRefs.contains(F))
+        BuiltinCalls[F].push_back(I);
     }
-    // Add all calls before beginning of ctor
-    if (Begin == nullptr)
-      if (this->isRemovableFunction(IDest))
-        ToRemove.insert(&I);
-    DBG_STMT(PrintCall(I, ToRemove.contains(&I)));
+  }
+}
+
+SmallVector<CallBase*, 0> DeBaser::getMarkers(Function* F, Function* BI) {
+  SmallVector<CallBase*, 0> Out;
+  auto It = BuiltinCalls.find(F);
+  if (It == BuiltinCalls.end())
+    return Out;
+  for (CallBase* I : It->second)
+    if (I->getCalledFunction() == BI)
+      Out.push_back(I);
+  return Out;
+}
+
+bool DeBaser::scanRemovableCall(CallBase& I,
+                                SmallVectorImpl<Instruction*>& ToRemove) const {
+  Function* IDest = I.getCalledFunction();
+  if (!IDest) {
+    if (!I.isIndirectCall())
+      return false;
+    DBG_STMT(I.print(errs() << '\n'));
     return true;
-  };
+  }
+  // Builtins were found through their uses.
+  if (IDest == BI__debase_mark_begin || IDest == BI__debase_mark_end
+   || IDest == BI__debase_continuation)
+    return true;
+  const bool Remove = this->isRemovableFunction(IDest);
+  if (Remove)
+    ToRemove.push_back(&I);
+  DBG_STMT(PrintCall(I, Remove));
+  return true;
+}
 
-  IterateInstructions(F, ScanFunc);
-  // Remove it all
-  for (Instruction* I : ToRemove) {
+void DeBaser::eraseCalls(Function* F, ArrayRef<Instruction*> ToRemove) {
+  unsigned NumErased = 0;
+  auto Erase = [&NumErased] (Instruction* I) {
     if (LLVM_UNLIKELY(I->isSafeToRemove())) {
       WithColor::warning(errs())
         << "Unable to remove instruction.\n";
-      continue;
+      return;
     }
     I->eraseFromParent();
+    ++NumErased;
+  };
+  for (Instruction* I : ToRemove)
+    Erase(I);
+  // Remove all builtins
+  auto It = BuiltinCalls.find(F);
+  if (It != BuiltinCalls.end()) {
+    for (CallBase* I : It->second) {
+      DBG_STMT(PrintCall(*I, 2));
+      Erase(I);
+    }
+    BuiltinCalls.erase(It);
   }
+  if (Stats) {
+    Stats->CallsRemoved += NumErased;
+    Stats->InstructionsErased += NumErased;
+  }
+}
+
+void DeBaser::countPatternHits(StringRef Name) {
+  assert(Stats && "Stats weren't requested!");
+  // The batch is long gone, so classify again.
+  SymbolFeatures Features;
+  SymClassifier->classify(Name, &Features);
+  SmallVector<StringRef, 2> Hits;
+  SM.findMatchingPatterns(Features, Hits);
+  for (StringRef Hit : Hits)
+    ++Stats->PatternHits[Hit];
+}
 
+bool DeBaser::debaseConstructor(Function* F) {
+  CallBase* Begin = GetFirstInLayout(getMarkers(F, BI__debase_mark_begin));
+  SmallVector<Instruction*, 16> ToRemove;
+  // Remove all calls before beginning of ctor
+  IterateCallsBefore(F, Begin, [&, this] (CallBase& I) {
+    return this->scanRemovableCall(I, ToRemove);
+  });
+  eraseCalls(F, ToRemove);
   return true;
 }
 
 bool DeBaser::debaseDestructor(Function* F) {
-  Instruction* End = nullptr;
-  //Instruction* Continue = nullptr;
-  SmallPtrSet<Instruction*, 32> ToRemove;
-
-  auto ScanFunc = [&, this] (CallBase& I) -> bool {
-    Function* IDest = I.getCalledFunction();
-    if (!IDest) {
-      if (!I.isIndirectCall())
-        return false;
-      I.print(errs() << '\n');
-      return true;
-    }
-    // Check if this is a __debase pseudofunction
-    if (BISet.contains(IDest)) {
-      // Check which one it is :)
-      if (BI__debase_mark_end == IDest) {
-        if (!End)
-          End = &I;
-        // We don't exit here so we can remove all builtins
-      }
-      DBG_STMT(PrintCall(I, 2));
-      ToRemove.insert(&I);
-      return true;
-    }
-    // Add all calls before beginning of ctor
-    if (End != nullptr)
-      if (this->isRemovableFunction(IDest))
-        ToRemove.insert(&I);
-    DBG_STMT(PrintCall(I, ToRemove.contains(&I)));
-    return true;
-  };
-
-  IterateInstructions(F, ScanFunc);
-  // Remove it all
-  for (Instruction* I : ToRemove) {
-    if (LLVM_UNLIKELY(I->isSafeToRemove())) {
-      WithColor::warning(errs())
-        << "Unable to remove instruction.\n";
-      continue;
-    }
-    I->eraseFromParent();
+  CallBase* End = GetFirstInLayout(getMarkers(F, BI__debase_mark_end));
+  SmallVector<Instruction*, 16> ToRemove;
+  // Remove all calls after the end of dtor
+  if (End) {
+    IterateCallsAfter(End, [&, this] (CallBase& I) {
+      return this->scanRemovableCall(I, ToRemove);
+    });
   }
-
+  eraseCalls(F, ToRemove);
   // TODO...
   return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
-bool DeBaser::loadModuleCommon(StringRef Filename) {
+bool DeBaser::loadModuleCommon(StringRef Filename, bool Prepared) {
   /*Update the ModuleID*/ {
     std::string ModuleID;
     raw_string_ostream OS(ModuleID);
@@ -875,30 +1412,52 @@ bool DeBaser::loadModuleCommon(StringRef Filename) {
     return false;
   }
 
-  // Strip debug info before running the verifier.
-  if (StripDebug)
-    llvm::StripDebugInfo(*M);
-
   // Erase module-level named metadata, if requested.
   if (StripNamedMetadata) {
     while (!M->named_metadata_empty()) {
       NamedMDNode* NMD = &*M->named_metadata_begin();
       M->eraseNamedMetadata(NMD);
+      this->Modified = true;
     }
   }
 
+  // Lazily loaded modules are handled once the rest has been materialized.
+  if (!Prepared && M->isMaterialized() && !prepareMaterializedModule())
+    return false;
+
+  this->LoadedModule = true;
+  return true;
+}
+
+bool DeBaser::prepareMaterializedModule() {
+  assert(M->isMaterialized() && "Module must be fully loaded!");
+  // Strip debug info before running the verifier.
+  if (StripDebug && llvm::StripDebugInfo(*M))
+    this->Modified = true;
+
   // Immediately run the verifier to catch any problems before starting up the
   // pass pipelines. Otherwise we can crash on broken code during
   // doInitialization().
+  PhaseScope PS(Phase::Verify);
   if (!NoVerify && verifyModule(*M, &errs())) {
     error() << "input module is broken!\n";
     return false;
   }
-
-  this->LoadedModule = true;
   return true;
 }
 
+bool DeBaser::materializeModule() {
+  if (M->isMaterialized())
+    return true;
+  PhaseScope PS(Phase::Parse);
+  if (Error E = M->materializeAll()) {
+    error() << "Unable to materialize '" << LLFile << "': "
+            << toString(std::move(E)) << '\n';
+    return false;
+  }
+  return prepareMaterializedModule();
+}
+
 bool DeBaser::loadModule(MemoryBufferRef IRFile, LLVMContext& Context) {
   if (LLVM_UNLIKELY(LoadedModule)) {
     error() << "Module has already been loaded as '"
@@ -907,7 +1466,15 @@ bool DeBaser::loadModule(MemoryBufferRef IRFile, LLVMContext& Context) {
   }
 
   SMDiagnostic Err;
-  M = parseIR(IRFile, Err, Context);
+  {
+    PhaseScope PS(Phase::Parse);
+    if (LazyBitcode) {
+      M = getLazyIRModule(
+        MemoryBuffer::getMemBuffer(IRFile, /*RequiresNullTerminator=*/false),
+        Err, Context);
+    } else
+      M = parseIR(IRFile, Err, Context);
+  }
   if (!M) {
     //if (!isASCII(IRFile.getBuffer()))
     Err.print(Argv0.data(), error());
@@ -927,7 +1494,13 @@ bool DeBaser::loadModule(StringRef Filename, LLVMContext& Context) {
   }
 
   SMDiagnostic Err;
-  M = parseIRFile(Filename, Err, Context);
+  {
+    PhaseScope PS(Phase::Parse);
+    if (LazyBitcode)
+      M = getLazyIRFileModule(Filename, Err, Context);
+    else
+      M = parseIRFile(Filename, Err, Context);
+  }
   if (!M) {
     
     Err.print(Argv0.data(), error());
@@ -937,13 +1510,13 @@ bool DeBaser::loadModule(StringRef Filename, LLVMContext& Context) {
   return loadModuleCommon(M->getSourceFileName());
 }
 
-DeBaser::PrevFunctionInfo DeBaser::GetInfoAndUpdate(Function* F, const SymbolFeatures& FFeats) {
+DeBaser::PrevFunctionInfo DeBaser::GetInfoAndUpdate(Function* F, SymbolKind K) {
   using enum Attribute::AttrKind;
   PrevFunctionInfo Info {
     .HadNoinline      = F->hasFnAttribute(NoInline),
     .HadAlwaysinline  = F->hasFnAttribute(AlwaysInline),
-    .IsCtor           = FFeats.isCtor(),
-    .IsDtor           = FFeats.isDtor()
+    .IsCtor           = (K == SymbolKind::Constructor),
+    .IsDtor           = (K == SymbolKind::Destructor)
   };
   if (!Info.HadNoinline)
     F->addFnAttr(NoInline);
@@ -961,13 +1534,17 @@ void DeBaser::ResetInfo(Function* F, const PrevFunctionInfo& Info) {
     F->addFnAttr(AlwaysInline);
 }
 
-void DeBaser::MakeBIRemovable(Function* F) {
+bool DeBaser::MakeBIRemovable(Function* F) {
   using enum Attribute::AttrKind;
   if (!F)
-    return;
+    return false;
+  if (F->hasFnAttribute(AlwaysInline) && !F->hasFnAttribute(NoInline)
+      && !F->hasFnAttribute(OptimizeNone))
+    return false;
   F->addFnAttr(AlwaysInline);
   F->removeFnAttr(NoInline);
   F->removeFnAttr(OptimizeNone);
+  return true;
 }
 
 void DeBaser::RemoveAllReferencesTo(Function* F) {
@@ -977,6 +1554,155 @@ void DeBaser::RemoveAllReferencesTo(Function* F) {
   F->removeFromParent();
 }
 
+/// The decisions made for a single config.
+struct DecisionSet {
+  const SymbolMatcher& SM;
+  DecisionCache* Decisions;
+  SmallVectorImpl<SymbolDecision>& Out;
+  /// Where demangling is counted, if anywhere.
+  ModuleStats* Stats = nullptr;
+};
+
+/// Decides every symbol in `Names` for each set, reusing and filling in their
+/// `Decisions`. Names are only classified once, however many sets there are.
+static void DecideSymbols(Classifier& C, ArrayRef<DecisionSet> Sets,
+                          ArrayRef<StringRef> Names) {
+  assert(!Sets.empty() && "Nothing to decide for!");
+  SmallVector<unsigned> Misses;
+  SmallVector<StringRef> MissNames;
+  for (const DecisionSet& S : Sets) {
+    S.Out.clear();
+    S.Out.reserve(Names.size());
+  }
+  for (unsigned I = 0, E = Names.size(); I != E; ++I) {
+    bool Missed = false;
+    for (const DecisionSet& S : Sets) {
+      std::optional<SymbolDecision> D;
+      if (S.Decisions)
+        D = S.Decisions->lookup(Names[I]);
+      Missed |= !D;
+      S.Out.push_back(D.value_or(SymbolDecision()));
+    }
+    if (Missed) {
+      Misses.push_back(I);
+      MissNames.push_back(Names[I]);
+    }
+  }
+
+  // Classify the remaining names at once, then match them for every set.
+  SymbolFeaturesBatch Batch {};
+  {
+    PhaseScope PS(Phase::Classify);
+    C.classifyAll(MissNames, Batch);
+  }
+  for (const DecisionSet& S : Sets) {
+    SmallVector<unsigned> Matched;
+    {
+      PhaseScope PS(Phase::Match);
+      S.SM.matchAll(Batch, Matched);
+    }
+    for (unsigned I = 0, E = Batch.size(); I != E; ++I) {
+      SymbolDecision& D = S.Out[Misses[I]];
+      D.Kind = Batch.kind(I);
+      D.Variant = Batch.variant(I);
+      D.Matched = false;
+    }
+    for (unsigned I : Matched)
+      S.Out[Misses[I]].Matched = true;
+    if (S.Decisions) {
+      // Matches can change between files with replacements.
+      const bool CanCacheMatches = !S.SM.dependsOnFilename();
+      for (unsigned I = 0, E = Batch.size(); I != E; ++I) {
+        if (CanCacheMatches || !Batch.isCtorDtor(I))
+          S.Decisions->insert(MissNames[I], S.Out[Misses[I]]);
+      }
+    }
+  }
+  unsigned NumFailures = 0;
+  for (unsigned I = 0, E = Batch.size(); I != E; ++I)
+    if (Batch.kind(I) == SymbolKind::Invalid)
+      ++NumFailures;
+  // Every set shares the classification, so each counts all of it.
+  for (const DecisionSet& S : Sets) {
+    if (!S.Stats)
+      continue;
+    S.Stats->NamesDemangled += Batch.size();
+    S.Stats->DemangleFailures += NumFailures;
+  }
+}
+
+/// Decides every symbol in `Names`, reusing and filling in `Decisions`.
+static void DecideSymbols(Classifier& C, const SymbolMatcher& SM,
+                          DecisionCache* Decisions, ArrayRef<StringRef> Names,
+                          SmallVectorImpl<SymbolDecision>& Out,
+                          ModuleStats* Stats = nullptr) {
+  DecisionSet Set {SM, Decisions, Out, Stats};
+  DecideSymbols(C, Set, Names);
+}
+
+/// Checks the symbol table of a module before parsing it, for the config of
+/// each worker. Returns nothing if the module must be parsed to know.
+static std::optional<ModuleScan> ScanModule(ArrayRef<DebaseWorker*> Ws,
+                                            MemoryBufferRef Data,
+                                            ArrayRef<ModuleStats*> Stats) {
+  assert(Stats.size() == Ws.size() && "Missing stats for a worker!");
+  std::optional<ModuleSymbols> Syms;
+  {
+    PhaseScope PS(Phase::Symtab);
+    Syms = ReadModuleSymbols(Data);
+  }
+  if (!Syms)
+    return std::nullopt;
+  // Invalid triples are reported once parsed.
+  auto IsItanium = checkTripleTargetSymbolType(llvm::Triple(Syms->Triple));
+  if (!IsItanium.has_value())
+    return std::nullopt;
+  // Classification doesn't depend on the config.
+  DebaseWorker& W = *Ws.front();
+  Classifier& C = *IsItanium
+    ? static_cast<Classifier&>(W.IClass) : W.MClass;
+  for (DebaseWorker* WK : Ws) {
+    if (!WK->SM.dependsOnFilename())
+      continue;
+    if (Error E = WK->SM.setFilename(Syms->SourceFileName)) {
+      consumeError(std::move(E));
+      return std::nullopt;
+    }
+  }
+
+  ModuleScan Scan;
+  bool HasBegin = false, HasEnd = false;
+  SmallVector<StringRef> Candidates;
+  for (StringRef Name : Syms->Names) {
+    if (Name == "__debase_mark_begin")
+      HasBegin = true;
+    else if (Name == "__debase_mark_end")
+      HasEnd = true;
+    else if (Name != "__debase_continuation") {
+      if (C.mayBeCtorDtor(Name))
+        Candidates.push_back(Name);
+      continue;
+    }
+    ++Scan.BICount;
+  }
+  Scan.HasMarkers = HasBegin && HasEnd;
+
+  std::vector<SmallVector<SymbolDecision>> Decided(Ws.size());
+  SmallVector<DecisionSet, 1> Sets;
+  for (unsigned K = 0, E = Ws.size(); K != E; ++K)
+    Sets.push_back({Ws[K]->SM, Ws[K]->Decisions, Decided[K], Stats[K]});
+  DecideSymbols(C, Sets, Candidates);
+  // Deleting destructors are never debased.
+  for (const auto& KDecided : Decided) {
+    Scan.MayMatchIn.push_back(
+      llvm::any_of(KDecided, [] (const SymbolDecision& D) {
+        return D.Matched && D.Variant != 0;
+      }));
+  }
+  Scan.MayMatch = llvm::is_contained(Scan.MayMatchIn, true);
+  return Scan;
+}
+
 bool DeBaser::loadAndUpdateRefsFromModule() {
   if (!LoadedModule)
     return false;
@@ -985,23 +1711,61 @@ bool DeBaser::loadAndUpdateRefsFromModule() {
     return false;
   }
 
-  SymbolFeatures FFeats {};
+  // Skip anything which can't be a ctor/dtor before demangling, and reuse
+  // anything already decided in other modules.
+  SmallVector<Function*> Candidates;
+  SmallVector<StringRef> Names;
   for (Function& F : M->getFunctionList()) {
-    std::string Name = F.getName().str();
-    SymClassifier->classify(Name, &FFeats);
-    if (!FFeats.isCtorDtor())
+    if (!SymClassifier->mayBeCtorDtor(F.getName()))
       continue;
-    // Check if itanium deleting destructor
-    if (FFeats.Variant == 0)
+    Candidates.push_back(&F);
+    Names.push_back(F.getName());
+  }
+  SmallVector<SymbolDecision> CandidateDecisions;
+  DecideSymbols(*SymClassifier, SM, Decisions, Names, CandidateDecisions,
+                Stats);
+  if (Stats) {
+    Stats->FunctionsScanned += M->size();
+    for (const SymbolDecision& D : CandidateDecisions)
+      if (D.Kind == SymbolKind::Constructor || D.Kind == SymbolKind::Destructor)
+        ++Stats->CtorDtorCandidates;
+  }
+
+  for (unsigned I = 0, E = Candidates.size(); I != E; ++I) {
+    const SymbolDecision& D = CandidateDecisions[I];
+    if (!D.Matched)
       continue;
-    if (!SM.match(FFeats))
+    Function& F = *Candidates[I];
+    // Check if itanium deleting destructor
+    if (D.Variant == 0)
       continue;
     // Check if this is an inline function
     if (F.hasComdat()) {
       WithColor::note(vbss())
         << "Skipping " << F.getName() << ", has comdat tag.\n";
+      if (Stats)
+        ++Stats->ComdatSkips;
       continue;
     }
+    // Lazily loaded, we only need the body now that it's been matched.
+    if (F.isMaterializable()) {
+      if (Error E = F.materialize()) {
+        error() << "Unable to materialize " << F.getName() << ": "
+                << toString(std::move(E)) << '\n';
+        if (!Permissive)
+          return false;
+        continue;
+      }
+      // The rest of the module is checked once materialized, but this body
+      // is about to be changed, so check it while it's still the input.
+      if (StripDebug && llvm::stripDebugInfo(F))
+        this->Modified = true;
+      PhaseScope PS(Phase::Verify);
+      if (!NoVerify && verifyFunction(F, &errs())) {
+        error() << "input function " << F.getName() << " is broken!\n";
+        return false;
+      }
+    }
     // TODO: Switch when complex added.
     //++EncounteredSimple;
 
@@ -1015,7 +1779,10 @@ bool DeBaser::loadAndUpdateRefsFromModule() {
       continue;
     }
 
-    It->second = GetInfoAndUpdate(&F, FFeats);
+    It->second = GetInfoAndUpdate(&F, D.Kind);
+    this->Modified = true;
+    if (Stats)
+      countPatternHits(F.getName());
     if (Verbose) {
       WithColor::note(vbss())
         << "Found " << F.getName() << '\n';
@@ -1051,27 +1818,156 @@ static ErrorOr<int> CreateToolOutputFile(StringRef OutPath) {
   return CreateToolOutputFile(OutPath, OutputAssembly);
 }
 
-ErrorOr<std::string> DeBaser::writeLLVM(const Twine& Dir) {
-  SmallString<80> OutPath;
+/// Gets the filename a module named `LLFile` is written to.
+static std::string GetOutputName(StringRef LLFile) {
+  SmallString<32> Name(sys::path::filename(LLFile).split('.').first);
+  sys::path::replace_extension(Name, GetOutputExtension());
+  return Name.str().str();
+}
+
+/// Gets the absolute path a module named `LLFile` is written to.
+static std::error_code GetOutputPath(StringRef LLFile, const Twine& Dir,
+                                     SmallVectorImpl<char>& OutPath) {
   Dir.toVector(OutPath);
-  sys::path::append(OutPath, sys::path::filename(LLFile).split('.').first);
-  sys::path::replace_extension(OutPath, OutputAssembly ? ".ll" : ".bc");
+  sys::path::append(OutPath, GetOutputName(LLFile));
   if (auto EC = sys::fs::make_absolute(OutPath)) {
-    errs() << "For '" << OutPath.str() << "'" << EC.message() << '\n';
+    errs() << "For '" << OutPath << "'" << EC.message() << '\n';
     return EC;
   }
   sys::path::remove_dots(OutPath);
-  // Open file
+  return std::error_code();
+}
+
+/// Opens the output file for the module `LLFile`.
+static ErrorOr<std::unique_ptr<ToolOutputFile>>
+ OpenOutputFile(StringRef LLFile, const Twine& Dir) {
+  SmallString<80> OutPath;
+  if (auto EC = GetOutputPath(LLFile, Dir, OutPath))
+    return EC;
+  // The old output may be linked into the cache, don't truncate it.
+  sys::fs::remove(OutPath);
   ErrorOr<int> FDOrErr = CreateToolOutputFile(OutPath.str());
   if (auto EC = FDOrErr.getError()) {
     errs() << "While opening '" << OutPath.str() << "'"
            << EC.message() << '\n';
     return EC;
   }
-  ToolOutputFile TheFile(OutPath.str(), *FDOrErr);
+  return std::make_unique<ToolOutputFile>(OutPath.str(), *FDOrErr);
+}
+
+/// Checks the output stream before keeping the file.
+static ErrorOr<std::string> FinishOutputFile(ToolOutputFile& TheFile) {
   auto& OS = TheFile.os();
-  // Write data to file
-  if (OutputAssembly)
+  if (auto EC = OS.error()) {
+    OS.clear_error();
+    errs() << "While writing '" << TheFile.outputFilename() << "'"
+           << EC.message() << '\n';
+    return EC;
+  }
+  TheFile.keep();
+  return TheFile.outputFilename();
+}
+
+/// Checks if `Buf` can be written as is, when the module is unchanged.
+static bool CanWriteUnchanged(MemoryBufferRef Buf) {
+  const auto* Begin =
+    reinterpret_cast<const unsigned char*>(Buf.getBufferStart());
+  const auto* End =
+    reinterpret_cast<const unsigned char*>(Buf.getBufferEnd());
+  return !OutputAssembly && !EmitObj && isBitcode(Begin, End);
+}
+
+/// Writes the original contents of the module `LLFile`.
+static ErrorOr<std::string> WriteUnchanged(StringRef LLFile, const Twine& Dir,
+                                           MemoryBufferRef Buf) {
+  auto FileOrErr = OpenOutputFile(LLFile, Dir);
+  if (auto EC = FileOrErr.getError())
+    return EC;
+  ToolOutputFile& TheFile = **FileOrErr;
+  TheFile.os() << Buf.getBuffer();
+  return FinishOutputFile(TheFile);
+}
+
+bool DeBaser::emitObject(raw_pwrite_stream& OS) {
+  const std::string& TripleStr = M->getTargetTriple();
+  // Fallback for when running without a worker.
+  std::optional<TargetCache> LocalTargets;
+  TargetCache* TC = Targets;
+  if (!TC)
+    TC = &LocalTargets.emplace(GetCodeGenOptLevel());
+  Expected<CachedTargetInfo*> InfoOrErr = TC->get(TripleStr);
+  if (!InfoOrErr) {
+    error() << "Unable to create target for '" << LLFile << "': "
+            << toString(InfoOrErr.takeError()) << '\n';
+    return false;
+  }
+  CachedTargetInfo& Info = **InfoOrErr;
+  TargetMachine& TM = *Info.TM;
+  if (M->getDataLayoutStr().empty())
+    M->setDataLayout(Info.DataLayoutStr);
+  // Applies `-mcpu`, `-mattr` and `--frame-pointer` like llc.
+  codegen::setFunctionAttributes(codegen::getCPUStr(),
+                                 codegen::getFeaturesStr(), *M);
+
+  legacy::PassManager PM;
+  PM.add(new TargetLibraryInfoWrapperPass(Info.TLII));
+  const auto FileType = OutputAssembly
+    ? CodeGenFileType::AssemblyFile : CodeGenFileType::ObjectFile;
+  if (TM.addPassesToEmitFile(PM, OS, nullptr, FileType)) {
+    error() << "Target '" << TripleStr << "' can't emit this file type.\n";
+    return false;
+  }
+  PM.run(*M);
+  return true;
+}
+
+ErrorOr<std::string> DeBaser::writeLLVM(const Twine& Dir) {
+  PhaseScope PS(Phase::Write);
+  // The writer needs everything.
+  if (!materializeModule())
+    return std::make_error_code(std::errc::invalid_argument);
+  if (Stats)
+    Stats->sampleMemory();
+  // Untouched, so don't bother serializing it again.
+  if (!Modified && Source && CanWriteUnchanged(*Source)) {
+    vbss() << "Writing '" << LLFile << "' unchanged.\n";
+    return WriteUnchanged(LLFile, Dir, *Source);
+  }
+
+  auto FileOrErr = OpenOutputFile(LLFile, Dir);
+  if (auto EC = FileOrErr.getError())
+    return EC;
+  ToolOutputFile& TheFile = **FileOrErr;
+  if (!writeModule(TheFile.os()))
+    return std::make_error_code(std::errc::invalid_argument);
+  return FinishOutputFile(TheFile);
+}
+
+std::unique_ptr<MemoryBuffer> DeBaser::writeLLVMToBuffer() {
+  PhaseScope PS(Phase::Write);
+  if (!materializeModule())
+    return nullptr;
+  if (Stats)
+    Stats->sampleMemory();
+  const std::string Name = GetOutputName(LLFile);
+  if (!Modified && Source && CanWriteUnchanged(*Source)) {
+    vbss() << "Writing '" << LLFile << "' unchanged.\n";
+    return MemoryBuffer::getMemBufferCopy(Source->getBuffer(), Name);
+  }
+
+  SmallVector<char, 0> Buf;
+  raw_svector_ostream OS(Buf);
+  if (!writeModule(OS))
+    return nullptr;
+  return std::make_unique<SmallVectorMemoryBuffer>(
+    std::move(Buf), Name, /*RequiresNullTerminator=*/false);
+}
+
+bool DeBaser::writeModule(raw_pwrite_stream& OS) {
+  if (EmitObj) {
+    if (!emitObject(OS))
+      return false;
+  } else if (OutputAssembly)
     M->print(OS, nullptr);
   else {
     bool IsNewDbgInfoFormat = M->IsNewDbgInfoFormat;
@@ -1079,50 +1975,88 @@ ErrorOr<std::string> DeBaser::writeLLVM(const Twine& Dir) {
       M->convertFromNewDbgValues();
       verify("DbgConversion");
     }
+    // The symbol table needs the target's asm parser.
+    InitializeBitcodeWriterFor(M->getTargetTriple());
     WriteBitcodeToFile(*M, OS);
     if (IsNewDbgInfoFormat)
       M->convertToNewDbgValues();
   }
-  if (auto EC = OS.error()) {
-    OS.clear_error();
-    errs() << "While writing '" << OutPath.str() << "'" << EC.message() << '\n';
-    return EC;
-  }
-  TheFile.keep();
-  return TheFile.outputFilename();
+  return true;
 }
 
-int main(int Argc, char** Argv) {
-  InitLLVM X(Argc, Argv);
-  LLVMInitializeEverything();
-
-  // Hide opt options from -help, but still allow the user to query them.
-  SemiHideUnrelatedOptions(DebaseToolCategory);
-
-  // Register the Target and CPU printer for --version.
-  cl::AddExtraVersionPrinter(&sys::printDefaultTargetAndDetectedCPU);
-  // Get the debaser version printer.
-  cl::AddExtraVersionPrinter([](raw_ostream& OS) {
-    OS << DEBASE_VENDOR_NAME << ":\n  "
-       << DEBASE_PACKAGE_NAME << " version "
-       << DEBASE_PACKAGE_VERSION << "\n";
-  });
+/// Describes everything besides the input which can change a written module.
+static std::string GetCacheSalt(const SymbolMatcher& SM, const char* Argv0) {
+  std::string Salt;
+  raw_string_ostream OS(Salt);
+  OS << DEBASE_PACKAGE_NAME << ' ' << DEBASE_PACKAGE_VERSION << '\n';
+  // Include the binary itself, so local rebuilds aren't mixed up.
+  std::string Exe = sys::fs::getMainExecutable(
+    Argv0, reinterpret_cast<void*>(&GetCacheSalt));
+  if (auto BufOrErr = MemoryBuffer::getFile(Exe))
+    OS << toHex(BLAKE3::hash(arrayRefFromStringRef((*BufOrErr)->getBuffer())));
+  OS << '\n' << SM.getFingerprint();
+  // The config filename ends up in the module identifier.
+  OS << "config: " << SM.getConfigFilename() << '\n';
+  if (!ConfigFiles.empty()) {
+    if (auto BufOrErr = MemoryBuffer::getFile(GetConfigFile()))
+      OS << toHex(BLAKE3::hash(
+        arrayRefFromStringRef((*BufOrErr)->getBuffer())));
+    OS << '\n';
+  }
+  OS << "flags: " << OutputAssembly << StripDebug << StripNamedMetadata
+     << EmitAll << AllowNoBI << NoVerify << VerifyEach
+     << int(VerifyScope.getValue()) << VerifyFinal << LazyBitcode
+     << Cleanup << StripDead << int(Hardening.getValue()) << '\n';
+  OS << "triple: " << TargetTriple << '\n';
+  OS << "layout: " << ClDataLayout << '\n';
+  if (EmitObj) {
+    // Other codegen flags (like --regalloc) need their own cache directory.
+    OS << "codegen: -O" << CodeGenOptLevelO << ' ' << codegen::getCPUStr()
+       << ' ' << codegen::getFeaturesStr() << ' '
+       << int(codegen::getFramePointerUsage()) << '\n';
+  }
+  return Salt;
+}
 
-  cl::ParseCommandLineOptions(Argc, Argv,
-    "llvmir pass that removes calls to bases in ctors/dtors.\n");
+static constexpr const char* kOverview =
+  "llvmir pass that removes calls to bases in ctors/dtors.\n";
+
+/// Resets every option before parsing a new request.
+static void ResetOptions() {
+  cl::ResetAllOptionOccurrences();
+  // These are only set by callbacks, which aren't run when reset.
+  Strict = Permissive = Verbose = false;
+  ArchiveOnly.reset();
+  EmitArchive.reset();
+  OutputSuccessfulFilenames.reset();
+  StatsFilename.reset();
+}
 
+/// Runs the driver with the parsed options. When serving, `ServedMatchers`
+/// keeps configs loaded between requests.
+static int RunDriver(const char* Argv0, MatcherCache* ServedMatchers) {
   //if (PrintPasses) {
   //  PassBuilder PB;
   //  PB.printPassNames(outs());
   //  return 0;
   //}
 
-  if (InputFilenames.empty() && ConfigFile.empty()) {
+  if (InputFilenames.empty() && ConfigFiles.empty()) {
     WithColor::error(errs())
       << "No input files provided!";
     return 1;
   }
 
+  EnablePhaseTimes(TimePhases);
+  if (!TraceOut.empty())
+    timeTraceProfilerInitialize(TraceGranularity, Argv0);
+
+  if (!CodeGenOpt::parseLevel(CodeGenOptLevelO)) {
+    WithColor::error(errs())
+      << "Invalid optimization level '-O" << CodeGenOptLevelO << "'.\n";
+    return 1;
+  }
+
   if (NoOutput && !OutputFilepath.empty()) {
     errs() << "WARNING: The -o (output path) option is ignored when the "
               "-disable-output option is used.\n";
@@ -1136,16 +2070,66 @@ int main(int Argc, char** Argv) {
     }
   }
 
-  auto SM = std::make_unique<SymbolMatcher>();
+  if (!CompileConfigOut.empty()) {
+    if (ConfigFiles.size() != 1) {
+      WithColor::error(errs())
+        << "--compile-config requires a single --config.\n";
+      return 1;
+    }
+    SymbolMatcher Compiler(Permissive);
+    Compiler.recordConfig();
+    SmallVector<std::string> ConfigFilenames;
+    if (Error E = Compiler.loadConfig(GetConfigFile(), &ConfigFilenames)) {
+      WithColor::error(errs())
+        << "Config file failed to process.\n"
+        << "reason: " << toString(std::move(E)) << "\n\n";
+      return 1;
+    }
+    std::error_code EC;
+    ToolOutputFile Out(CompileConfigOut, EC, sys::fs::OF_None);
+    if (EC) {
+      WithColor::error(errs())
+        << "Error opening '" << CompileConfigOut << "': "
+        << EC.message() << '\n';
+      return 1;
+    }
+    if (Error E = Compiler.writeCompiledConfig(Out.os(), ConfigFilenames)) {
+      WithColor::error(errs()) << toString(std::move(E)) << '\n';
+      return 1;
+    }
+    Out.keep();
+    WithColor::remark(outs())
+      << "Compiled config '" << GetConfigFile() << "' to '"
+      << CompileConfigOut << "'.\n";
+    return 0;
+  }
+
+  // Configs are kept between requests when serving.
+  std::unique_ptr<SymbolMatcher> OwnedSM = std::make_unique<SymbolMatcher>();
+  SymbolMatcher* SM = OwnedSM.get();
   //LLVMContext Context;
 
   // TODO: Unique filenames.
   UniqueStringVector ValidFilenames;
+  // The configs each input is debased for, by ID. Inputs from the command line
+  // are for every config, the rest only for the configs listing them.
+  std::vector<SmallBitVector> InputConfigs;
+  auto AddInputConfig = [&] (unsigned ID, std::optional<size_t> K) {
+    if (InputConfigs.size() < ID)
+      InputConfigs.resize(ID, SmallBitVector(
+        std::max<size_t>(ConfigFiles.size(), 1)));
+    if (K)
+      InputConfigs[ID - 1].set(*K);
+    else
+      InputConfigs[ID - 1].set();
+  };
   for (auto& Filename : InputFilenames) {
     if (FixupFilename(Filename)) {
-      auto [_, DidInsert] = ValidFilenames.try_insert(Filename);
-      if (DidInsert)
+      auto [ID, DidInsert] = ValidFilenames.try_insert(Filename);
+      if (DidInsert) {
+        AddInputConfig(ID, std::nullopt);
         continue;
+      }
       WithColor::warning(errs())
         << "Duplicate filename '" << Filename << "'.\n";
       if (Strict)
@@ -1157,21 +2141,63 @@ int main(int Argc, char** Argv) {
         return 1;
     }
   }
-  if (!ConfigFile.empty()) {
+  // The matchers of every config, for the first worker.
+  SmallVector<SymbolMatcher*, 1> ConfigSMs {SM};
+  // Matchers owned by this run, rather than the server.
+  SmallVector<std::unique_ptr<SymbolMatcher>, 8> Matchers;
+  for (size_t K = 0, E = ConfigFiles.size(); K < E; ++K) {
     SmallVector<std::string> ConfigFilenames;
-    const auto& Conf = ConfigFile.getValue();
-    Error E = SM->loadSymbolsFromJSONFile(Conf, &ConfigFilenames);
-    if (LLVM_UNLIKELY(E)) {
+    const auto& Conf = ConfigFiles[K];
+    auto LoadConfig = [&] () -> Error {
+      if (K == 0) {
+        if (ServedMatchers)
+          return ServedMatchers->get(Conf, &ConfigFilenames).moveInto(
+            ConfigSMs.front());
+        return SM->loadSymbolsFromJSONFile(Conf, &ConfigFilenames);
+      }
+      // The other configs get their own matchers, which must be isolated.
+      SymbolMatcher* KSM = ConfigSMs.emplace_back(Matchers.emplace_back(
+        std::make_unique<SymbolMatcher>(Permissive,
+                                        /*IsolateExternal=*/true)).get());
+      return KSM->loadSymbolsFromJSONFile(Conf, &ConfigFilenames);
+    };
+    if (Error Err = LoadConfig()) {
       WithColor::error(errs())
         << "Config file failed to process.\n"
-        << "reason: " << toString(std::move(E)) << "\n\n";
+        << "reason: " << toString(std::move(Err)) << "\n\n";
       return 1;
     }
     for (auto& Filename : ConfigFilenames)
-      ValidFilenames.insert(Filename);
+      AddInputConfig(ValidFilenames.insert(Filename), K);
     WithColor::remark(outs())
       << "Loaded config '" << Conf << "'.\n";
   }
+  SM = ConfigSMs.front();
+  const size_t NumConfigs = ConfigSMs.size();
+
+  // With fan-out, every config is written to its own directory.
+  std::vector<std::string> OutputDirs(NumConfigs, OutputFilepath.getValue());
+  if (NumConfigs > 1) {
+    StringSet<> Seen;
+    for (size_t K = 0; K < NumConfigs; ++K) {
+      SmallString<80> Dir(OutputFilepath.getValue());
+      sys::path::append(Dir, sys::path::stem(ConfigFiles[K]));
+      if (!Seen.insert(Dir).second) {
+        WithColor::error(errs())
+          << "Configs '" << ConfigFiles[K] << "' would share the output "
+          << "directory '" << Dir << "'.\n";
+        return 1;
+      }
+      if (!NoOutput) {
+        if (auto EC = sys::fs::create_directories(Dir)) {
+          WithColor::error(errs())
+            << "Error creating '" << Dir << "': " << EC.message() << '\n';
+          return 1;
+        }
+      }
+      OutputDirs[K] = Dir.str().str();
+    }
+  }
   if (ValidFilenames.empty()) {
     WithColor::error(errs())
       << "No valid input files were provided!";
@@ -1196,7 +2222,7 @@ int main(int Argc, char** Argv) {
       return 1;
     }
     raw_fd_ostream OS(*FDOrErr, true);
-    if (Error E = createARFile(OS, ArName, ValidFilenames)) {
+    if (Error E = createARFile(OS, ArName, ValidFilenames, ThinArchive)) {
     //if (Error E = createARFile(ArName, ValidFilenames)) {
       WithColor::error(errs())
         << "Failed to create archive: "
@@ -1208,15 +2234,56 @@ int main(int Argc, char** Argv) {
     return 0;
   }
 
-  //std::vector<std::unique_ptr<MemoryBuffer>> ArchiveFiles;
+  // Outputs are kept in memory until the archive is written.
+  const bool ToArchive = EmitArchive && !NoOutput;
+  if (ToArchive && OutputAssembly) {
+    WithColor::error(errs())
+      << "--emit-archive can't be used with textual output.\n";
+    return 1;
+  } else if (ToArchive && NumConfigs > 1) {
+    WithColor::error(errs())
+      << "--emit-archive can't be used with multiple configs.\n";
+    return 1;
+  }
+
+  std::unique_ptr<ModuleCache> Cache;
+  if (!CacheDir.empty() && NoOutput) {
+    errs() << "WARNING: The --cache-dir option is ignored when the "
+              "-disable-output option is used.\n";
+  } else if (!CacheDir.empty() && ToArchive) {
+    errs() << "WARNING: The --cache-dir option is ignored when the "
+              "--emit-archive option is used.\n";
+  } else if (!CacheDir.empty() && NumConfigs > 1) {
+    errs() << "WARNING: The --cache-dir option is ignored with multiple "
+              "configs.\n";
+  } else if (!CacheDir.empty()) {
+    auto CacheOrErr = ModuleCache::Open(CacheDir, GetCacheSalt(*SM, Argv0),
+                                        GetOutputExtension());
+    if (!CacheOrErr) {
+      WithColor::error(errs()) << toString(CacheOrErr.takeError()) << '\n';
+      return 1;
+    }
+    Cache = std::move(*CacheOrErr);
+  }
+
+  /// Archive members point into these, so they're kept for the whole run.
+  std::vector<std::unique_ptr<MemoryBuffer>> ArchiveFiles;
+  ThinMemberList ThinMembers;
   BumpPtrAllocator ArBP;
   std::vector<MemoryBufferRef> ExtraModuleFiles;
+  /// The configs of each archive member, from the archive.
+  std::vector<SmallBitVector> ExtraModuleConfigs;
+  std::vector<ModuleJob> Jobs;
 
   /// Returns true if parsing should continue (.ll or .bc).
   /// Otherwise an archive was saved and should be handled later.
-  auto LoadIROrArchive = [&] (StringRef Filename, std::unique_ptr<MemoryBuffer>& Out) -> bool {
-    ErrorOr<std::unique_ptr<MemoryBuffer>> FileOrError
-        = MemoryBuffer::getFile(Filename, /*IsText=*/false);
+  auto LoadIROrArchive = [&] (StringRef Filename,
+                              const SmallBitVector& Configs,
+                              std::unique_ptr<MemoryBuffer>& Out) -> bool {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> FileOrError = [&] {
+      PhaseScope PS(Phase::Read);
+      return MemoryBuffer::getFile(Filename, /*IsText=*/false);
+    }();
     if (auto EC = FileOrError.getError()) {
       WithColor::error(errs())
         << "Error loading '" << Filename << "': "
@@ -1227,7 +2294,10 @@ int main(int Argc, char** Argv) {
 
     // Load file so we can see its contents
     std::unique_ptr<MemoryBuffer> FileBuffer = std::move(*FileOrError);
-    file_magic FileKind = identify_magic_ex(FileBuffer->getBuffer());
+    file_magic FileKind = [&] {
+      PhaseScope PS(Phase::Magic);
+      return identify_magic_ex(FileBuffer->getBuffer());
+    }();
 
     // bitcode would either be a real .bc file or a detected .ll file      
     if (FileKind == file_magic::bitcode) {
@@ -1249,18 +2319,30 @@ int main(int Argc, char** Argv) {
       return false;
     }
 
+    // Members are read when the job is run, one at a time.
+    if (StreamArchives) {
+      Jobs.push_back({Filename, std::nullopt, std::move(FileBuffer), Configs});
+      return false;
+    }
+
     // Now try and parse the archive contents.
-    if (Error E = extractInMemoryARFile(*FileBuffer, ExtraModuleFiles, ArBP)) {
+    PhaseScope PS(Phase::Archive);
+    if (Error E = extractInMemoryARFile(*FileBuffer, ExtraModuleFiles, ArBP,
+                                        ThinMembers)) {
       std::string ErrMsg = toString(std::move(E));
       WithColor::error(errs()) << ErrMsg << '\n';
       debase_tool::exitP(1);
     }
+    ExtraModuleConfigs.resize(ExtraModuleFiles.size(), Configs);
 
+    ArchiveFiles.push_back(std::move(FileBuffer));
     return false;
   };
 
   // The following was copied from llvm/tools/opt/optdriver.cpp
   //
+  // Only used on the main thread, workers have their own.
+  TargetCache LayoutTargets(GetCodeGenOptLevel());
   auto SetDataLayout = [&](StringRef IRTriple,
                            StringRef IRLayout) -> std::optional<std::string> {
     // Data layout specified on the command line has the highest priority.
@@ -1283,21 +2365,22 @@ int main(int Argc, char** Argv) {
     if (TripleStr.empty())
       return std::nullopt;
     // Otherwise we infer the DataLayout from the target machine.
-    Expected<std::unique_ptr<TargetMachine>> ExpectedTM =
-        codegen::createTargetMachineForTriple(
-          TripleStr, GetCodeGenOptLevel());
-    if (!ExpectedTM) {
-      WithColor::warning(errs(), Argv[0])
+    Expected<CachedTargetInfo*> InfoOrErr = LayoutTargets.get(TripleStr);
+    if (!InfoOrErr) {
+      WithColor::warning(errs(), Argv0)
         << "failed to infer data layout: "
-        << toString(ExpectedTM.takeError()) << "\n";
+        << toString(InfoOrErr.takeError()) << "\n";
       return std::nullopt;
     }
-    return (*ExpectedTM)->createDataLayout().getStringRepresentation();
+    return (*InfoOrErr)->DataLayoutStr;
   };
   
   // Holds all the successful Modules output files.
   std::unique_ptr<ToolOutputFile> JSONRecord;
-  auto LoadToolOutputFile = [&](StringRef Filename) -> Error {
+  // Holds the statistics of every module.
+  std::unique_ptr<ToolOutputFile> StatsRecord;
+  auto LoadToolOutputFile = [&](StringRef Filename,
+                                std::unique_ptr<ToolOutputFile>& Out) -> Error {
     using namespace std::literals;
     SmallString<128> Path;
     // Default to standard output.
@@ -1312,12 +2395,12 @@ int main(int Argc, char** Argv) {
     if (auto EC = FDOrErr.getError())
       return errorCodeToError(EC);
     // Boss.
-    JSONRecord.reset(new ToolOutputFile(Path.str(), *FDOrErr));
+    Out.reset(new ToolOutputFile(Path.str(), *FDOrErr));
     return Error::success();
   };
 
   if (OutputSuccessfulFilenames) {
-    if (Error E = LoadToolOutputFile(*OutputSuccessfulFilenames)) {
+    if (Error E = LoadToolOutputFile(*OutputSuccessfulFilenames, JSONRecord)) {
       WithColor::error(errs())
         << "Failed to generate output file list.\n";
       return 1;
@@ -1327,6 +2410,19 @@ int main(int Argc, char** Argv) {
     JSONRecord->os() << "{\n\"files\": [\n";
   }
 
+  if (StatsFilename) {
+    if (Error E = LoadToolOutputFile(*StatsFilename, StatsRecord)) {
+      WithColor::error(errs())
+        << "Failed to generate statistics file.\n";
+      return 1;
+    }
+  }
+
+  // Writes outputs once they've been serialized, off the workers.
+  std::optional<AsyncWriter> Writer;
+  if (IODepth != 0 && !NoOutput && !ToArchive)
+    Writer.emplace(IODepth);
+
   ListSeparator OutLS(",\n");
   auto JSONRecordFilename = [&] (StringRef Filename) {
     if (!JSONRecord)
@@ -1335,34 +2431,68 @@ int main(int Argc, char** Argv) {
     JSONRecord->os() << OutLS << '\"' << Path << '\"';
   };
 
-  DeBaser::Factory DBFactory(*SM, Argv[0]);
-  ItaniumClassifier IClass;
-  MSVCClassifier MClass;
-
   /// Handles the actual debasing implementation based on local variables.
-  auto HandleDebasing = [&] (DeBaser* DB, StringRef Filename) {
-    auto WriteDB = [&, DB, Filename] () {
+  /// @return The filename to record, if the module was emitted.
+  auto HandleDebasing = [&] (DebaseWorker& W, DeBaser* DB, StringRef Filename,
+                             bool Untouched = false, ModuleStats* MS = nullptr)
+                             -> std::optional<std::string> {
+    auto WriteDB = [&, DB, Filename] (StringRef Status)
+                                     -> std::optional<std::string> {
       if (!DB->isOk()) {
         WithColor::warning(errs())
           << "Module '" << Filename << "' is corrupted.\n";
-        return;
+        if (MS)
+          MS->Status = "corrupted";
+        return std::nullopt;
       } else if (Verbose) {
         vbss() << "Module '" << Filename << "' verified.\n";
       }
 
-      if (!NoOutput) {
-        auto OFOrErr = DB->writeLLVM(OutputFilepath.getValue());
+      std::optional<std::string> Out;
+      if (ToArchive) {
+        if ((W.Written = DB->writeLLVMToBuffer())) {
+          Out = W.Written->getBufferIdentifier().str();
+          if (MS) {
+            MS->Status = Status;
+            MS->OutputBytes = W.Written->getBufferSize();
+          }
+        } else
+          WithColor::warning(errs()) << "Unable to write module.\n";
+        return Out;
+      } else if (Writer) {
+        SmallString<80> OutPath;
+        std::unique_ptr<MemoryBuffer> Buf;
+        if (!GetOutputPath(Filename, W.OutputDir, OutPath))
+          Buf = DB->writeLLVMToBuffer();
+        if (Buf) {
+          if (MS)
+            MS->OutputBytes = Buf->getBufferSize();
+          Out = OutPath.str().str();
+          Writer->write(*Out, std::move(Buf), OutputAssembly);
+        } else
+          WithColor::warning(errs()) << "Unable to write file.\n";
+      } else if (!NoOutput) {
+        auto OFOrErr = DB->writeLLVM(W.OutputDir);
         if (!OFOrErr.getError())
-          JSONRecordFilename(*OFOrErr);
+          Out = std::move(*OFOrErr);
         else
           WithColor::warning(errs()) << "Unable to write file.\n";
-      } else
-        JSONRecordFilename(Filename);
+      } else if (DB->materializeModule()) {
+        // Lazy modules are only checked in full once materialized.
+        Out = Filename.str();
+      }
+      if (MS && Out) {
+        MS->Status = Status;
+        uint64_t Size = 0;
+        if (!NoOutput && !Writer && !sys::fs::file_size(*Out, Size))
+          MS->OutputBytes = Size;
+      }
       
       if (Verbose) {
         outs().flush();
         errs() << '\n';
       }
+      return Out;
     };
 
     //LLVMContext LocalCtx;
@@ -1372,7 +2502,7 @@ int main(int Argc, char** Argv) {
         << "Failed to generate module for '"
         << Filename << "'.\n";
       debase_tool::exitP(1);
-      return;
+      return std::nullopt;
     }
 
     llvm::Triple T = DB->getTriple();
@@ -1380,13 +2510,29 @@ int main(int Argc, char** Argv) {
     if (!IsItanium.has_value()) {
       errs() << "Invalid triple for '" << Filename
              << "': " << T.getTriple() << "\n";
-      return;
+      return std::nullopt;
+    }
+
+    DB->setTargetCache(&W.Targets);
+    if (MS) {
+      DB->setStats(MS);
+      // Clones live in another worker's context, so ask the module.
+      MS->ContextModules = DB->getContextModules();
+      MS->ContextsCreated = DB->createdContext();
+      MS->sampleMemory();
+    }
+    // Nothing to debase, the module is only being emitted.
+    if (Untouched) {
+      if (!AllowNoBI)
+        errs() << "Unable to load builtins for '" << Filename << "'\n";
+      return WriteDB("emitted");
     }
 
     if (*IsItanium)
-      DB->setNameDemangler(&IClass);
+      DB->setNameDemangler(&W.IClass);
     else
-      DB->setNameDemangler(&MClass);
+      DB->setNameDemangler(&W.MClass);
+    DB->setDecisionCache(W.Decisions);
 
     if (!DB->loadRefsAndBuiltins()) {
       if (!AllowNoBI || DB->getBICount() != 0)
@@ -1394,9 +2540,9 @@ int main(int Argc, char** Argv) {
       if (EmitAll) {
         DB->removeBI__debase();
         DB->verify("RemoveBIPartial");
-        WriteDB();
+        return WriteDB("emitted");
       }
-      return;
+      return std::nullopt;
     }
 
     // Crashes for no fucking reason
@@ -1409,41 +2555,528 @@ int main(int Argc, char** Argv) {
     DB->removeBI__debase();
     DB->verify("RemoveBI");
 
-    // TODO: Run aggressive optimizer?
+    if (Cleanup) {
+      if (!DB->runCleanupPasses())
+        return std::nullopt;
+      DB->verify("Cleanup");
+    }
+    if (StripDead) {
+      if (!DB->removeDeadDefinitions())
+        return std::nullopt;
+      DB->verify("StripDead");
+    }
+    if (VerifyFinal)
+      DB->verifyNow("Final", /*WholeModule=*/true);
     // Write module
-    WriteDB();
+    return WriteDB("debased");
   };
 
+  // Keeps the buffers of directly loaded modules alive.
+  std::vector<std::unique_ptr<MemoryBuffer>> LoadedFiles;
+
   // Handle loading llvmir/bitcode files and dispatching archives. 
-  for (StringRef Filename : ValidFilenames) {
+  for (unsigned ID = 1, E = ValidFilenames.size(); ID <= E; ++ID) {
+    StringRef Filename = ValidFilenames[ID];
+    const SmallBitVector& Configs = InputConfigs[ID - 1];
     if (Filename.empty())
       continue;
 
     // Check if this is a recognized format
     if (!Filename.ends_with(".ll") && !Filename.ends_with(".bc")) {
       std::unique_ptr<MemoryBuffer> Out;
-      if (!LoadIROrArchive(Filename, Out))
+      if (!LoadIROrArchive(Filename, Configs, Out))
         continue;
       assert(Out && "Didn't actually load file?");
-      std::unique_ptr<DeBaser> DB = DBFactory.From(*Out);
-      HandleDebasing(DB.get(), Filename);
+      Jobs.push_back({Filename, MemoryBufferRef(*Out), nullptr, Configs});
+      LoadedFiles.push_back(std::move(Out));
       continue;
     }
 
-    std::unique_ptr<DeBaser> DB = DBFactory.New(Filename);
-    HandleDebasing(DB.get(), Filename);
+    Jobs.push_back({Filename, std::nullopt, nullptr, Configs});
+  }
+
+  // Archive members are handled after all the regular files.
+  for (size_t I = 0, E = ExtraModuleFiles.size(); I < E; ++I) {
+    MemoryBufferRef Data = ExtraModuleFiles[I];
+    Jobs.push_back({Data.getBufferIdentifier(), Data, nullptr,
+                    ExtraModuleConfigs[I]});
+  }
+
+  /// Checks if an untouched module can be written without parsing it.
+  auto CanSkipParse = [&] (MemoryBufferRef Data) {
+    return !Strict && !NoOutput && !StripDebug && !StripNamedMetadata
+        && CanWriteUnchanged(Data);
+  };
+
+  /// Writes the original contents of a module for `W`'s config.
+  auto WriteUnchangedFor = [&] (DebaseWorker& W, MemoryBufferRef Data,
+                                StringRef Name, ModuleStats* MS)
+                                -> std::optional<std::string> {
+    vbss() << "File: " << Name << " (unchanged)\n";
+    if (!AllowNoBI)
+      errs() << "Unable to load builtins for '" << Name << "'\n";
+    std::optional<std::string> Out;
+    if (ToArchive) {
+      W.Written = MemoryBuffer::getMemBufferCopy(Data.getBuffer(),
+                                                 GetOutputName(Name));
+      Out = W.Written->getBufferIdentifier().str();
+    } else if (Writer) {
+      SmallString<80> OutPath;
+      if (!GetOutputPath(Name, W.OutputDir, OutPath)) {
+        // The input isn't kept alive past this module.
+        Writer->write(OutPath.str().str(),
+                      MemoryBuffer::getMemBufferCopy(Data.getBuffer()));
+        Out = OutPath.str().str();
+      }
+    } else {
+      auto OFOrErr = WriteUnchanged(Name, W.OutputDir, Data);
+      if (!OFOrErr.getError())
+        Out = std::move(*OFOrErr);
+    }
+    if (!Out)
+      WithColor::warning(errs()) << "Unable to write file.\n";
+    else if (MS) {
+      MS->Status = "unchanged";
+      MS->OutputBytes = Data.getBufferSize();
+    }
+    return Out;
+  };
+
+  /// Debases a module from memory, going through the cache if enabled.
+  auto DebaseModule = [&] (DebaseWorker& W, MemoryBufferRef Data,
+                           StringRef Name, ModuleStats* MS = nullptr)
+                           -> std::optional<std::string> {
+    TimeTraceScope ModuleScope("Module", Name);
+    if (MS) {
+      MS->InputBytes = Data.getBufferSize();
+      MS->startMemory();
+    }
+    // Most modules have nothing to debase, so check before parsing them.
+    std::optional<ModuleScan> Scan = ScanModule({&W}, Data, {MS});
+    if (Scan && !Scan->HasMarkers && !EmitAll) {
+      vbss() << "File: " << Name << " (skipped)\n";
+      if (MS)
+        MS->Status = "skipped";
+      if (!AllowNoBI || Scan->BICount != 0)
+        errs() << "Unable to load builtins for '" << Name << "'\n";
+      return std::nullopt;
+    }
+
+    std::string Key;
+    if (Cache) {
+      SmallString<80> OutPath;
+      if (!GetOutputPath(Name, W.OutputDir, OutPath)) {
+        Key = Cache->getKey(Data);
+        if (Cache->fetch(Key, OutPath)) {
+          vbss() << "File: " << Name << " (cached)\n";
+          uint64_t Size = 0;
+          if (MS && !sys::fs::file_size(OutPath, Size)) {
+            MS->Status = "cached";
+            MS->OutputBytes = Size;
+          }
+          return OutPath.str().str();
+        }
+      }
+    }
+
+    const bool Untouched = Scan && Scan->isUntouched();
+    std::optional<std::string> Out;
+    // Nothing would change, so skip parsing unless it must be verified.
+    if (Untouched && CanSkipParse(Data))
+      Out = WriteUnchangedFor(W, Data, Name, MS);
+    else {
+      std::unique_ptr<DeBaser> DB = W.Factory.From(Data);
+      Out = HandleDebasing(W, DB.get(), Name, Untouched, MS);
+    }
+    if (Out && !Key.empty()) {
+      auto Store = [C = Cache.get(), Key, Path = *Out] {
+        if (Error E = C->store(Key, Path))
+          WithColor::warning(errs()) << toString(std::move(E)) << '\n';
+      };
+      // The output only exists once its write has finished.
+      if (Writer)
+        Writer->enqueue(std::move(Store));
+      else
+        Store();
+    }
+    return Out;
+  };
+
+  /// Debases a module for the config of every worker in `Ws`. It's scanned,
+  /// parsed and classified once, then copied for each config which needs it.
+  auto DebaseFanOut = [&] (ArrayRef<DebaseWorker*> Ws, MemoryBufferRef Data,
+                           StringRef Name,
+                           function_ref<ModuleStats*(StringRef)> NewStats)
+                           -> SmallVector<std::string, 2> {
+    TimeTraceScope ModuleScope("Module", Name);
+    SmallVector<std::string, 2> Outs;
+    SmallVector<ModuleStats*, 2> MSs;
+    for (DebaseWorker* W : Ws) {
+      ModuleStats* MS = NewStats((Name + "@" + W->SM.getConfigFilename()).str());
+      if (MS) {
+        MS->InputBytes = Data.getBufferSize();
+        MS->startMemory();
+      }
+      MSs.push_back(MS);
+    }
+
+    std::optional<ModuleScan> Scan = ScanModule(Ws, Data, MSs);
+    if (Scan && !Scan->HasMarkers && !EmitAll) {
+      vbss() << "File: " << Name << " (skipped)\n";
+      for (ModuleStats* MS : MSs) {
+        if (MS)
+          MS->Status = "skipped";
+      }
+      if (!AllowNoBI || Scan->BICount != 0)
+        errs() << "Unable to load builtins for '" << Name << "'\n";
+      return Outs;
+    }
+
+    // The configs which need the module parsed.
+    SmallVector<unsigned, 2> ToParse;
+    for (unsigned K = 0, E = Ws.size(); K != E; ++K) {
+      if (Scan && Scan->isUntouchedIn(K) && CanSkipParse(Data)) {
+        if (auto Out = WriteUnchangedFor(*Ws[K], Data, Name, MSs[K]))
+          Outs.push_back(std::move(*Out));
+      } else
+        ToParse.push_back(K);
+    }
+    if (ToParse.empty())
+      return Outs;
+
+    // The last config takes the parsed module, so the rest are copied first.
+    const unsigned Last = ToParse.pop_back_val();
+    std::unique_ptr<DeBaser> Parsed = Ws[Last]->Factory.From(Data);
+    for (unsigned K : ToParse) {
+      if (!Parsed)
+        break;
+      DebaseWorker& W = *Ws[K];
+      // Lazy modules only materialize what matched, so reading them again is
+      // cheaper than copying everything.
+      std::unique_ptr<DeBaser> DB = LazyBitcode
+        ? W.Factory.From(Data) : W.Factory.Clone(*Parsed);
+      const bool Untouched = Scan && Scan->isUntouchedIn(K);
+      if (auto Out = HandleDebasing(W, DB.get(), Name, Untouched, MSs[K]))
+        Outs.push_back(std::move(*Out));
+    }
+    const bool Untouched = Scan && Scan->isUntouchedIn(Last);
+    if (auto Out = HandleDebasing(*Ws[Last], Parsed.get(), Name, Untouched,
+                                  MSs[Last]))
+      Outs.push_back(std::move(*Out));
+    return Outs;
+  };
+
+  // Reads the modules which aren't in memory yet ahead of the workers.
+  std::optional<Prefetcher> Reader;
+  if (IODepth != 0) {
+    std::vector<StringRef> ToRead(Jobs.size());
+    for (size_t I = 0, E = Jobs.size(); I < E; ++I) {
+      if (!Jobs[I].Data && !Jobs[I].Archive)
+        ToRead[I] = Jobs[I].Filename;
+    }
+    Reader.emplace(std::move(ToRead), IODepth);
   }
 
-  // Handle loading llvmir/bitcode files and dispatching archives.
-  for (MemoryBufferRef Data : ExtraModuleFiles) {
-    std::unique_ptr<DeBaser> DB = DBFactory.From(Data);
-    HandleDebasing(DB.get(), Data.getBufferIdentifier());
+  // The outputs of each job, written out in input order.
+  std::vector<SmallVector<std::string, 1>> Outputs(Jobs.size());
+  // The archive members of each job, with `--emit-archive`.
+  std::vector<std::vector<NewArchiveMember>> Members(Jobs.size());
+  // The statistics of each job, if requested.
+  std::vector<std::deque<ModuleStats>> AllStats(Jobs.size());
+  /// Runs job `I` with `AllWs`, which has a worker for every config. Only the
+  /// configs listing the module are used, like separate runs would.
+  auto RunJob = [&] (ArrayRef<DebaseWorker*> AllWs, size_t I) {
+    ModuleJob& Job = Jobs[I];
+    SmallVector<DebaseWorker*, 4> Ws;
+    for (unsigned K : Job.Configs.set_bits())
+      Ws.push_back(AllWs[K]);
+    assert(!Ws.empty() && "Module isn't for any config?");
+    DebaseWorker& W = *Ws.front();
+    // Archives and fan-out add a record per module and config.
+    auto NewStats = [&] (StringRef Name) -> ModuleStats* {
+      if (!StatsRecord)
+        return nullptr;
+      ModuleStats& MS = AllStats[I].emplace_back();
+      MS.Name = Name.str();
+      return &MS;
+    };
+    auto AddOutput = [&] (std::optional<std::string> Out) {
+      if (!Out)
+        return;
+      Outputs[I].push_back(std::move(*Out));
+      if (!W.Written)
+        return;
+      NewArchiveMember& NM = Members[I].emplace_back();
+      NM.MemberName = W.Written->getBufferIdentifier();
+      NM.Buf = std::move(W.Written);
+    };
+    auto Run = [&] (MemoryBufferRef Data, StringRef Name) {
+      if (NumConfigs == 1)
+        return AddOutput(DebaseModule(W, Data, Name, NewStats(Name)));
+      for (std::string& Out : DebaseFanOut(Ws, Data, Name, NewStats))
+        AddOutput(std::move(Out));
+    };
+    if (Job.Archive) {
+      Error E = streamInMemoryARFile(*Job.Archive, [&] (MemoryBufferRef Data) {
+        Run(Data, Data.getBufferIdentifier());
+      });
+      if (E) {
+        WithColor::error(errs()) << toString(std::move(E)) << '\n';
+        debase_tool::exitP(1);
+      }
+      // All members have been written, so we're done with it.
+      Job.Archive.reset();
+      return;
+    }
+
+    if (Job.Data) {
+      Run(*Job.Data, Job.Filename);
+      return;
+    }
+
+    // The pre-scan and cache need the contents, so load them here instead.
+    std::unique_ptr<MemoryBuffer> Buf;
+    if (Reader) {
+      if (auto BufOrErr = Reader->take(I))
+        Buf = std::move(*BufOrErr);
+    } else {
+      PhaseScope PS(Phase::Read);
+      if (auto BufOrErr = MemoryBuffer::getFile(Job.Filename))
+        Buf = std::move(*BufOrErr);
+    }
+    // Unreadable, so let the parser report it (once, for the first config).
+    if (!Buf) {
+      TimeTraceScope ModuleScope("Module", Job.Filename);
+      ModuleStats* MS = NewStats(Job.Filename);
+      if (MS)
+        MS->startMemory();
+      std::unique_ptr<DeBaser> DB = W.Factory.New(Job.Filename);
+      AddOutput(HandleDebasing(W, DB.get(), Job.Filename,
+                               /*Untouched=*/false, MS));
+      return;
+    }
+    Run(*Buf, Job.Filename);
+  };
+
+  ThreadPoolStrategy Strategy = heavyweight_hardware_concurrency(NumThreads);
+  const size_t NumWorkers =
+    std::min<size_t>(Strategy.compute_thread_count(), Jobs.size());
+
+  // Inline ctors/dtors show up in many modules, only decide them once. Each
+  // config gets its own, as they match different symbols.
+  std::vector<DecisionCache> Decisions(NumConfigs);
+  // Every thread gets a worker for each config, `NumConfigs` at a time.
+  std::vector<std::unique_ptr<DebaseWorker>> Workers;
+  std::vector<DebaseWorker*> WorkerPtrs;
+  auto AddWorkers = [&] (size_t T) -> Error {
+    for (size_t K = 0; K < NumConfigs; ++K) {
+      // Every thread needs its own matchers, as `setFilename` modifies the
+      // held patterns. The first can just reuse the originals.
+      SymbolMatcher* WSM = ConfigSMs[K];
+      auto LoadWorkerMatcher = [&] () -> Error {
+        if (T == 0)
+          return Error::success();
+        if (ServedMatchers && K == 0 && !ConfigFiles.empty())
+          return ServedMatchers->getWorker(GetConfigFile(), T).moveInto(WSM);
+        WSM = Matchers.emplace_back(std::make_unique<SymbolMatcher>(
+          Permissive, /*IsolateExternal=*/true)).get();
+        if (ConfigFiles.empty())
+          return Error::success();
+        return WSM->loadConfig(ConfigFiles[K]);
+      };
+      if (Error E = LoadWorkerMatcher())
+        return E;
+      WorkerPtrs.push_back(Workers.emplace_back(std::make_unique<DebaseWorker>(
+        *WSM, Argv0, &Decisions[K], OutputDirs[K])).get());
+    }
+    return Error::success();
+  };
+  auto WorkersFor = [&] (size_t T) {
+    return ArrayRef(WorkerPtrs).slice(T * NumConfigs, NumConfigs);
+  };
+
+  const size_t NumGroups = std::max<size_t>(NumWorkers, 1);
+  for (size_t T = 0; T < NumGroups; ++T) {
+    if (Error E = AddWorkers(T)) {
+      WithColor::error(errs())
+        << "Config file failed to process for worker.\n"
+        << "reason: " << toString(std::move(E)) << "\n\n";
+      return 1;
+    }
+  }
+
+  // The pool and the I/O threads are still running during jobs, so fatal
+  // errors stop new jobs from starting rather than exiting.
+  std::atomic<bool> JobFailed = false;
+  std::atomic<bool>* const OuterFailed = RequestFailed;
+  RequestFailed = &JobFailed;
+  if (NumGroups == 1) {
+    for (size_t I = 0, E = Jobs.size(); I < E && !JobFailed; ++I)
+      RunJob(WorkersFor(0), I);
+  } else {
+    vbss() << "Running with " << NumGroups << " workers.\n";
+    std::atomic<size_t> NextJob = 0;
+    DefaultThreadPool Pool(Strategy);
+    for (size_t T = 0; T < NumGroups; ++T) {
+      Pool.async([&, Ws = WorkersFor(T)] {
+        if (!TraceOut.empty())
+          timeTraceProfilerInitialize(TraceGranularity, "debase-worker");
+        for (size_t I = NextJob++; I < Jobs.size() && !JobFailed;
+                    I = NextJob++)
+          RunJob(Ws, I);
+        if (!TraceOut.empty())
+          timeTraceProfilerFinishThread();
+      });
+    }
+    Pool.wait();
+  }
+  RequestFailed = OuterFailed;
+  if (JobFailed) {
+    if (OuterFailed)
+      *OuterFailed = true;
+    // Let pending writes finish, but don't record a partial run.
+    if (Writer)
+      Writer->wait();
+    if (!TraceOut.empty())
+      timeTraceProfilerCleanup();
+    return 1;
+  }
+
+  if (ToArchive) {
+    std::vector<NewArchiveMember> AllMembers;
+    for (auto& JobMembers : Members) {
+      for (NewArchiveMember& NM : JobMembers)
+        AllMembers.push_back(std::move(NM));
+    }
+    SmallString<80> ArchivePath(OutputFilepath.getValue());
+    sys::path::append(ArchivePath, *EmitArchive);
+    sys::fs::make_absolute(ArchivePath);
+    ErrorOr<int> FDOrErr = CreateToolOutputFile(ArchivePath, false);
+    if (auto EC = FDOrErr.getError()) {
+      WithColor::error(errs())
+        << "Failed to create archive: " << EC.message() << "\n";
+      return 1;
+    }
+    ToolOutputFile Archive(ArchivePath, *FDOrErr);
+    if (Error E = createARFile(Archive.os(), AllMembers)) {
+      WithColor::error(errs())
+        << "Failed to create archive: "
+        << toString(std::move(E)) << "\n";
+      return 1;
+    }
+    Archive.keep();
+    vbss() << "Generated archive '" << ArchivePath << "' with "
+           << AllMembers.size() << " members.\n";
+    // The members aren't files, so only the archive is recorded.
+    JSONRecordFilename(ArchivePath);
+  } else {
+    // Outputs which failed to write aren't recorded.
+    const StringSet<> NoFailures;
+    const StringSet<>& Failures = Writer ? Writer->wait() : NoFailures;
+    for (const auto& JobOutputs : Outputs) {
+      for (const std::string& Out : JobOutputs) {
+        if (!Failures.contains(Out))
+          JSONRecordFilename(Out);
+      }
+    }
   }
 
   if (JSONRecord) {
     JSONRecord->os() << "\n]\n}";
     JSONRecord->keep();
   }
+
+  if (StatsRecord) {
+    ModuleStats Total;
+    size_t NumModules = 0;
+    json::OStream J(StatsRecord->os(), /*IndentSize=*/2);
+    J.object([&] {
+      J.attributeArray("modules", [&] {
+        for (const auto& JobStats : AllStats) {
+          for (const ModuleStats& MS : JobStats) {
+            Total.add(MS);
+            ++NumModules;
+            J.object([&] {
+              J.attribute("name", sys::path::convert_to_slash(MS.Name));
+              J.attribute("status", MS.Status);
+              MS.print(J);
+            });
+          }
+        }
+      });
+      J.attributeObject("total", [&] {
+        J.attribute("modules", int64_t(NumModules));
+        Total.print(J);
+      });
+    });
+    StatsRecord->os() << '\n';
+    StatsRecord->keep();
+  }
+
+  if (TimePhases)
+    PrintPhaseTimes(*CreateInfoOutputFile());
+  if (!TraceOut.empty()) {
+    if (Error E = timeTraceProfilerWrite(TraceOut, "debase")) {
+      WithColor::error(errs()) << "Unable to write trace '" << TraceOut
+                               << "': " << toString(std::move(E)) << '\n';
+    }
+    timeTraceProfilerCleanup();
+  }
+  return 0;
+}
+
+int main(int Argc, char** Argv) {
+  InitLLVM X(Argc, Argv);
+  // Everything else is initialized once a triple needs it.
+  InitializeTargetInfos();
+
+  // Hide opt options from -help, but still allow the user to query them.
+  SemiHideUnrelatedOptions(DebaseToolCategory);
+
+  // Register the Target and CPU printer for --version.
+  cl::AddExtraVersionPrinter(&sys::printDefaultTargetAndDetectedCPU);
+  // Get the debaser version printer.
+  cl::AddExtraVersionPrinter([](raw_ostream& OS) {
+    OS << DEBASE_VENDOR_NAME << ":\n  "
+       << DEBASE_PACKAGE_NAME << " version "
+       << DEBASE_PACKAGE_VERSION << "\n";
+  });
+
+  cl::ParseCommandLineOptions(Argc, Argv, kOverview);
+
+  if (Serve.getNumOccurrences() == 0)
+    return RunDriver(Argv[0], nullptr);
+
+  // Everything but `--patterns` is given with each request.
+  const std::string SocketPath = Serve.getValue();
+  MatcherCache Matchers;
+  auto Handle = [&] (const ServeRequest& Req) -> int {
+    ResetOptions();
+    SmallVector<const char*, 16> Args {Argv[0]};
+    for (const std::string& Arg : Req.Args)
+      Args.push_back(Arg.c_str());
+    if (!cl::ParseCommandLineOptions(Args.size(), Args.data(), kOverview,
+                                     &errs()))
+      return 1;
+    if (Serve.getNumOccurrences() != 0) {
+      WithColor::error(errs()) << "Requests can't use '--serve'.\n";
+      return 1;
+    }
+    if (cl::getRegisteredOptions().lookup("patterns")->getNumOccurrences()) {
+      WithColor::error(errs())
+        << "'--patterns' must be passed when starting the server.\n";
+      return 1;
+    }
+    // Fatal errors fail this request, rather than the whole server.
+    std::atomic<bool> Failed = false;
+    RequestFailed = &Failed;
+    const int Status = RunDriver(Argv[0], &Matchers);
+    RequestFailed = nullptr;
+    return (Status == 0 && Failed) ? 1 : Status;
+  };
+  if (SocketPath.empty())
+    return ServeStdin(Handle);
+  return ServeSocket(SocketPath, Handle);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1463,61 +3096,3 @@ static std::vector<FunctionPass*> GetO1PassesRequiredForSimplification() {
     Out.push_back(Pass);
   return Out;
 }
-
-namespace {
-  inline void InitializeTargetInfos() {
-#define LLVM_TARGET(TargetName) LLVMInitialize##TargetName##TargetInfo();
-    INITIALIZE_TARGETS(LLVM_TARGET)
-#undef LLVM_TARGET
-  }
-
-  inline void InitializeTargets() {
-#define LLVM_TARGET(TargetName) LLVMInitialize##TargetName##Target();
-    INITIALIZE_TARGETS(LLVM_TARGET)
-#undef LLVM_TARGET
-  }
-
-  inline void InitializeTargetMCs() {
-#define LLVM_TARGET(TargetName) LLVMInitialize##TargetName##TargetMC();
-    INITIALIZE_TARGETS(LLVM_TARGET)
-#undef LLVM_TARGET
-  }
-
-  inline void InitializeAsmPrinters() {
-#define LLVM_ASM_PRINTER(TargetName) LLVMInitialize##TargetName##AsmPrinter();
-    INITIALIZE_TARGETS(LLVM_ASM_PRINTER)
-#undef LLVM_ASM_PRINTER
-  }
-
-  inline void InitializeAsmParsers() {
-#define LLVM_ASM_PARSER(TargetName) LLVMInitialize##TargetName##AsmParser();
-    INITIALIZE_TARGETS(LLVM_ASM_PARSER)
-#undef LLVM_ASM_PARSER
-  }
-
-  inline void InitializeDisassemblers() {
-#define LLVM_DISASSEMBLER(TargetName) LLVMInitialize##TargetName##Disassembler();
-    INITIALIZE_TARGETS(LLVM_DISASSEMBLER)
-#undef LLVM_DISASSEMBLER
-  }
-} // namespace `anonymous`
-
-static void LLVMInitializeEverything() {
-  InitializeTargetInfos();
-  InitializeTargets();
-  InitializeTargetMCs();
-  InitializeAsmPrinters();
-  InitializeAsmParsers();
-  InitializeDisassemblers();
-
-  // Copied from llvm/tools/opt/optdriver.cpp
-  //
-  // Initialize passes
-  PassRegistry &Registry = *PassRegistry::getPassRegistry();
-  initializeCore(Registry);
-  initializeScalarOpts(Registry);
-  initializeAnalysis(Registry);
-  initializeTransformUtils(Registry);
-  initializeInstCombine(Registry);
-  initializeTarget(Registry);
-}
@@ -0,0 +1,164 @@
+//===- driver/IOPipeline.cpp ----------------------------------------------===//
+//
+// Copyright (C) 2026 Ninefold
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the Prefetcher and AsyncWriter classes.
+///
+//===----------------------------------------------------------------------===//
+
+#include "IOPipeline.hpp"
+#include "PhaseTimer.hpp"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/WithColor.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+
+using namespace debase_tool;
+using namespace llvm;
+
+Prefetcher::Prefetcher(std::vector<StringRef> Files, unsigned Depth)
+ : Files(std::move(Files)), Depth(std::max(Depth, 1u)),
+   Thread([this] { run(); }) {}
+
+Prefetcher::~Prefetcher() {
+  {
+    std::lock_guard Guard(Lock);
+    Stop = true;
+  }
+  Changed.notify_all();
+  Thread.join();
+}
+
+void Prefetcher::run() {
+  for (size_t I = 0, E = Files.size(); I < E; ++I) {
+    if (Files[I].empty())
+      continue;
+    {
+      std::unique_lock Guard(Lock);
+      Changed.wait(Guard, [this] { return Stop || Ready.size() < Depth; });
+      if (Stop)
+        return;
+    }
+    BufferOrError BufOrErr = [&] {
+      PhaseScope PS(Phase::Read);
+      return MemoryBuffer::getFile(Files[I], /*IsText=*/false);
+    }();
+    {
+      std::lock_guard Guard(Lock);
+      Ready.emplace(I, std::move(BufOrErr));
+      Next = I + 1;
+    }
+    Changed.notify_all();
+  }
+}
+
+Prefetcher::BufferOrError Prefetcher::take(size_t I) {
+  assert(I < Files.size() && !Files[I].empty() && "File isn't read!");
+  std::unique_lock Guard(Lock);
+  Changed.wait(Guard, [&] { return Ready.contains(I) || Next > I; });
+  auto It = Ready.find(I);
+  // Taken twice, treat it like the file disappeared.
+  if (It == Ready.end())
+    return std::make_error_code(std::errc::no_such_file_or_directory);
+  BufferOrError BufOrErr = std::move(It->second);
+  Ready.erase(It);
+  Guard.unlock();
+  Changed.notify_all();
+  return BufOrErr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+AsyncWriter::AsyncWriter(unsigned Depth)
+ : Depth(std::max(Depth, 1u)), Thread([this] { run(); }) {}
+
+AsyncWriter::~AsyncWriter() {
+  wait();
+  {
+    std::lock_guard Guard(Lock);
+    Stop = true;
+  }
+  Changed.notify_all();
+  Thread.join();
+}
+
+void AsyncWriter::run() {
+  while (true) {
+    unique_function<void()> Task;
+    {
+      std::unique_lock Guard(Lock);
+      Changed.wait(Guard, [this] { return Stop || !Tasks.empty(); });
+      if (Tasks.empty())
+        return;
+      Task = std::move(Tasks.front());
+      Tasks.pop_front();
+      Busy = true;
+    }
+    Changed.notify_all();
+    Task();
+    {
+      std::lock_guard Guard(Lock);
+      Busy = false;
+    }
+    Changed.notify_all();
+  }
+}
+
+void AsyncWriter::enqueue(unique_function<void()> Task) {
+  {
+    std::unique_lock Guard(Lock);
+    Changed.wait(Guard, [this] { return Tasks.size() < Depth; });
+    Tasks.push_back(std::move(Task));
+  }
+  Changed.notify_all();
+}
+
+void AsyncWriter::write(std::string Path, std::unique_ptr<MemoryBuffer> Buf,
+                        bool IsText) {
+  enqueue([this, Path = std::move(Path), Buf = std::move(Buf), IsText] {
+    PhaseScope PS(Phase::Write);
+    // The old output may be linked into the cache, don't truncate it.
+    sys::fs::remove(Path);
+    std::error_code EC;
+    {
+      raw_fd_ostream OS(Path, EC,
+                        IsText ? sys::fs::OF_TextWithCRLF : sys::fs::OF_None);
+      if (!EC) {
+        OS << Buf->getBuffer();
+        OS.close();
+        if (OS.has_error()) {
+          EC = OS.error();
+          OS.clear_error();
+        }
+      }
+    }
+    if (!EC)
+      return;
+    WithColor::warning(errs())
+      << "While writing '" << Path << "': " << EC.message() << '\n';
+    sys::fs::remove(Path);
+    std::lock_guard Guard(Lock);
+    Failures.insert(Path);
+  });
+}
+
+const StringSet<>& AsyncWriter::wait() {
+  std::unique_lock Guard(Lock);
+  Changed.wait(Guard, [this] { return Tasks.empty() && !Busy; });
+  return Failures;
+}
@@ -0,0 +1,102 @@
+//===- driver/IOPipeline.hpp ----------------------------------------------===//
+//
+// Copyright (C) 2026 Ninefold
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file declares the I/O stages around the workers. The `Prefetcher`
+/// reads inputs ahead of them, and the `AsyncWriter` writes their outputs
+/// behind, so file latency overlaps with debasing.
+///
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "LLVM.hpp"
+#include "llvm/ADT/FunctionExtras.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace debase_tool {
+
+/// Reads files on a background thread, keeping at most `Depth` loaded.
+class Prefetcher {
+  using BufferOrError = llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>;
+  /// The files to read, in order. Empty entries are skipped.
+  std::vector<StringRef> Files;
+  const unsigned Depth;
+
+  std::mutex Lock;
+  std::condition_variable Changed;
+  /// Files which have been read, but not taken.
+  std::map<size_t, BufferOrError> Ready;
+  size_t Next = 0;
+  bool Stop = false;
+  std::thread Thread;
+
+public:
+  Prefetcher(std::vector<StringRef> Files, unsigned Depth);
+  ~Prefetcher();
+
+  /// Waits for the contents of `Files[I]`, which can only be taken once.
+  /// Files must be taken roughly in order, or the reader stalls.
+  BufferOrError take(size_t I);
+
+private:
+  void run();
+};
+
+/// Runs tasks in order on a background thread, keeping at most `Depth`
+/// queued. Used for writing outputs once they've been serialized.
+class AsyncWriter {
+  const unsigned Depth;
+
+  std::mutex Lock;
+  std::condition_variable Changed;
+  std::deque<llvm::unique_function<void()>> Tasks;
+  /// If a task is currently running.
+  bool Busy = false;
+  bool Stop = false;
+  /// Outputs which couldn't be written.
+  llvm::StringSet<> Failures;
+  std::thread Thread;
+
+public:
+  explicit AsyncWriter(unsigned Depth);
+  ~AsyncWriter();
+
+  /// Queues `Task`, blocking while the queue is full.
+  void enqueue(llvm::unique_function<void()> Task);
+  /// Queues writing `Buf` to `Path`, replacing any existing file.
+  void write(std::string Path, std::unique_ptr<llvm::MemoryBuffer> Buf,
+             bool IsText = false);
+  /// Waits for every queued task, returning the outputs which failed.
+  const llvm::StringSet<>& wait();
+
+private:
+  void run();
+};
+
+} // namespace debase_tool
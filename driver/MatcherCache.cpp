@@ -0,0 +1,80 @@
+//===- driver/MatcherCache.cpp --------------------------------------------===//
+//
+// Copyright (C) 2026 Ninefold
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the MatcherCache class.
+///
+//===----------------------------------------------------------------------===//
+
+#include "MatcherCache.hpp"
+#include "Shared.hpp"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+
+using namespace debase_tool;
+using namespace llvm;
+
+std::string MatcherCache::GetKey(StringRef ConfigFile) {
+  SmallString<128> Path(ConfigFile);
+  sys::fs::make_absolute(Path);
+  sys::path::remove_dots(Path, /*remove_dot_dot=*/true);
+  return (Twine(Permissive ? 'P' : '-') + Path).str();
+}
+
+Expected<SymbolMatcher*>
+ MatcherCache::get(StringRef ConfigFile, SmallVectorImpl<std::string>* OutFiles) {
+  sys::fs::file_status Status;
+  if (auto EC = sys::fs::status(ConfigFile, Status))
+    return createFileError(ConfigFile, EC);
+
+  Entry& E = Entries[GetKey(ConfigFile)];
+  if (E.Matchers.empty() || E.ModTime != Status.getLastModificationTime()) {
+    auto SM = std::make_unique<SymbolMatcher>();
+    SmallVector<std::string, 0> Files;
+    if (Error Err = SM->loadSymbolsFromJSONFile(ConfigFile, &Files)) {
+      // Don't keep anything stale around.
+      E.Matchers.clear();
+      return std::move(Err);
+    }
+    E.ModTime = Status.getLastModificationTime();
+    E.Files = std::move(Files);
+    E.Matchers.clear();
+    E.Matchers.push_back(std::move(SM));
+  }
+
+  if (OutFiles)
+    OutFiles->append(E.Files.begin(), E.Files.end());
+  return E.Matchers.front().get();
+}
+
+Expected<SymbolMatcher*>
+ MatcherCache::getWorker(StringRef ConfigFile, unsigned I) {
+  assert(I != 0 && "The first matcher isn't isolated!");
+  auto It = Entries.find(GetKey(ConfigFile));
+  if (It == Entries.end() || It->second.Matchers.empty())
+    return MakeError("Config '" + ConfigFile + "' was never loaded");
+  Entry& E = It->second;
+  while (E.Matchers.size() <= I) {
+    auto SM = std::make_unique<SymbolMatcher>(Permissive,
+                                              /*IsolateExternal=*/true);
+    if (Error Err = SM->loadConfig(ConfigFile))
+      return std::move(Err);
+    E.Matchers.push_back(std::move(SM));
+  }
+  return E.Matchers[I].get();
+}
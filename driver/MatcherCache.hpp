@@ -0,0 +1,64 @@
+//===- driver/MatcherCache.hpp --------------------------------------------===//
+//
+// Copyright (C) 2026 Ninefold
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file defines the MatcherCache class, which keeps compiled configs
+/// alive between requests in `--serve`.
+///
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Chrono.h"
+#include "llvm/Support/Error.h"
+#include "LLVM.hpp"
+#include "SymbolMatcher.hpp"
+#include <memory>
+#include <string>
+
+namespace debase_tool {
+
+/// Matchers loaded from config files, keyed on the path and reloaded when
+/// the file is modified.
+class MatcherCache {
+  struct Entry {
+    llvm::sys::TimePoint<> ModTime;
+    /// The files listed by the config.
+    SmallVector<std::string, 0> Files;
+    /// The first shares `--patterns`, the rest are isolated for workers.
+    SmallVector<std::unique_ptr<SymbolMatcher>, 8> Matchers;
+  };
+  llvm::StringMap<Entry> Entries;
+
+public:
+  /// Returns the matcher for `ConfigFile`, appending the files it lists to
+  /// `OutFiles`. Reloads the config if it changed since the last call.
+  llvm::Expected<SymbolMatcher*>
+   get(StringRef ConfigFile, SmallVectorImpl<std::string>* OutFiles = nullptr);
+  /// Returns the isolated matcher for worker `I` (from 1). The config must
+  /// have been loaded by `get` first.
+  llvm::Expected<SymbolMatcher*> getWorker(StringRef ConfigFile, unsigned I);
+
+private:
+  /// Returns the key for `ConfigFile`, matchers also depend on `-permissive`.
+  static std::string GetKey(StringRef ConfigFile);
+};
+
+} // namespace debase_tool
@@ -0,0 +1,91 @@
+//===- driver/ModuleCache.cpp ---------------------------------------------===//
+//
+// Copyright (C) 2026 Ninefold
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the ModuleCache class.
+///
+//===----------------------------------------------------------------------===//
+
+#include "ModuleCache.hpp"
+#include "Shared.hpp"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/BLAKE3.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+
+using namespace debase_tool;
+using namespace llvm;
+
+Expected<std::unique_ptr<ModuleCache>>
+ ModuleCache::Open(StringRef Dir, StringRef Salt, StringRef Ext) {
+  if (auto EC = sys::fs::create_directories(Dir))
+    return MakeError("Error creating cache '" + Dir + "': " + EC.message());
+  SmallString<128> AbsDir(Dir);
+  if (auto EC = sys::fs::make_absolute(AbsDir))
+    return MakeError("For cache '" + Dir + "': " + EC.message());
+  sys::path::remove_dots(AbsDir);
+  return std::unique_ptr<ModuleCache>(
+    new ModuleCache(AbsDir, Salt.str(), Ext));
+}
+
+std::string ModuleCache::getKey(MemoryBufferRef Input) const {
+  BLAKE3 Hasher;
+  Hasher.update(Salt);
+  Hasher.update(Input.getBuffer());
+  return toHex(Hasher.final(), /*LowerCase=*/true);
+}
+
+void ModuleCache::getEntryPath(StringRef Key,
+                               SmallVectorImpl<char>& Out) const {
+  Out.assign(Dir.begin(), Dir.end());
+  sys::path::append(Out, Key + Ext);
+}
+
+bool ModuleCache::fetch(StringRef Key, StringRef OutPath) const {
+  SmallString<128> Entry;
+  getEntryPath(Key, Entry);
+  if (!sys::fs::exists(Entry))
+    return false;
+  // Never write through an existing link into the cache.
+  if (sys::fs::remove(OutPath))
+    return false;
+  if (!sys::fs::create_hard_link(Entry, OutPath))
+    return true;
+  // Different filesystems, fall back to copying.
+  return !sys::fs::copy_file(Entry, OutPath);
+}
+
+Error ModuleCache::store(StringRef Key, StringRef OutPath) const {
+  SmallString<128> Entry;
+  getEntryPath(Key, Entry);
+  // Linking is atomic, and fails if another process got here first.
+  std::error_code EC = sys::fs::create_hard_link(OutPath, Entry);
+  if (!EC || EC == std::errc::file_exists)
+    return Error::success();
+  // Otherwise copy to a temporary, so an entry only ever appears whole.
+  SmallString<128> Tmp;
+  sys::fs::createUniquePath(Twine(Entry) + "-%%%%%%.tmp", Tmp,
+                            /*MakeAbsolute=*/false);
+  if ((EC = sys::fs::copy_file(OutPath, Tmp)))
+    return MakeError("Unable to cache '" + OutPath + "': " + EC.message());
+  if ((EC = sys::fs::rename(Tmp, Entry))) {
+    sys::fs::remove(Tmp);
+    return MakeError("Unable to cache '" + OutPath + "': " + EC.message());
+  }
+  return Error::success();
+}
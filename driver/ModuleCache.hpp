@@ -0,0 +1,66 @@
+//===- driver/ModuleCache.hpp ---------------------------------------------===//
+//
+// Copyright (C) 2026 Ninefold
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file defines the ModuleCache class, a content-addressed store of
+/// debased modules which persists between runs.
+///
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBufferRef.h"
+#include "LLVM.hpp"
+#include <memory>
+#include <string>
+
+namespace debase_tool {
+
+/// A directory of written modules, keyed on the input contents and everything
+/// else which can change the output. Entries are only ever added whole, so
+/// multiple processes can share a directory.
+class ModuleCache {
+  SmallString<128> Dir;
+  /// Hash of everything shared between modules (binary, config, flags).
+  std::string Salt;
+  /// Extension of the cached outputs.
+  std::string Ext;
+
+  ModuleCache(StringRef Dir, std::string Salt, StringRef Ext)
+   : Dir(Dir), Salt(std::move(Salt)), Ext(Ext.str()) {}
+
+public:
+  /// Opens the cache at `Dir`, creating it if it doesn't exist.
+  static llvm::Expected<std::unique_ptr<ModuleCache>>
+   Open(StringRef Dir, StringRef Salt, StringRef Ext);
+
+  /// Returns the key for a module with the contents `Input`.
+  std::string getKey(llvm::MemoryBufferRef Input) const;
+  /// Places the entry for `Key` at `OutPath`.
+  /// @return `false` if uncached.
+  bool fetch(StringRef Key, StringRef OutPath) const;
+  /// Adds the file at `OutPath` to the cache as `Key`.
+  llvm::Error store(StringRef Key, StringRef OutPath) const;
+
+private:
+  void getEntryPath(StringRef Key, SmallVectorImpl<char>& Out) const;
+};
+
+} // namespace debase_tool
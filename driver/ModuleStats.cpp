@@ -0,0 +1,96 @@
+//===- driver/ModuleStats.cpp ---------------------------------------------===//
+//
+// Copyright (C) 2026 Ninefold
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the ModuleStats struct.
+///
+//===----------------------------------------------------------------------===//
+
+#include "ModuleStats.hpp"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/Process.h"
+#include <algorithm>
+
+using namespace debase_tool;
+using namespace llvm;
+
+void ModuleStats::startMemory() {
+  MemoryBaseline = sys::Process::GetMallocUsage();
+}
+
+void ModuleStats::sampleMemory() {
+  const uint64_t Usage = sys::Process::GetMallocUsage();
+  ProcessMemory = Usage;
+  if (Usage > MemoryBaseline)
+    PeakMemory = std::max(PeakMemory, Usage - MemoryBaseline);
+}
+
+void ModuleStats::add(const ModuleStats& Other) {
+  FunctionsScanned += Other.FunctionsScanned;
+  NamesDemangled += Other.NamesDemangled;
+  DemangleFailures += Other.DemangleFailures;
+  CtorDtorCandidates += Other.CtorDtorCandidates;
+  ComdatSkips += Other.ComdatSkips;
+  FunctionsDebased += Other.FunctionsDebased;
+  CallsRemoved += Other.CallsRemoved;
+  InstructionsErased += Other.InstructionsErased;
+  DeadFunctions += Other.DeadFunctions;
+  DeadGlobals += Other.DeadGlobals;
+  DeadGlobalBytes += Other.DeadGlobalBytes;
+  InputBytes += Other.InputBytes;
+  OutputBytes += Other.OutputBytes;
+  // Modules are freed once written, so the peaks don't add up.
+  PeakMemory = std::max(PeakMemory, Other.PeakMemory);
+  ProcessMemory = std::max(ProcessMemory, Other.ProcessMemory);
+  ContextsCreated += Other.ContextsCreated;
+  ContextModules = std::max(ContextModules, Other.ContextModules);
+  for (const StringMapEntry<uint64_t>& KV : Other.PatternHits)
+    PatternHits[KV.first()] += KV.second;
+}
+
+void ModuleStats::print(json::OStream& J) const {
+  J.attribute("functions_scanned", FunctionsScanned);
+  J.attribute("names_demangled", NamesDemangled);
+  J.attribute("demangle_failures", DemangleFailures);
+  J.attribute("ctor_dtor_candidates", CtorDtorCandidates);
+  J.attribute("comdat_skips", ComdatSkips);
+  J.attribute("functions_debased", FunctionsDebased);
+  J.attribute("calls_removed", CallsRemoved);
+  J.attribute("instructions_erased", InstructionsErased);
+  J.attribute("dead_functions", DeadFunctions);
+  J.attribute("dead_globals", DeadGlobals);
+  J.attribute("dead_global_bytes", DeadGlobalBytes);
+  J.attribute("input_bytes", InputBytes);
+  J.attribute("output_bytes", OutputBytes);
+  J.attribute("peak_memory_bytes", PeakMemory);
+  J.attribute("process_memory_bytes", ProcessMemory);
+  J.attribute("contexts_created", ContextsCreated);
+  J.attribute("context_modules", ContextModules);
+  // Sorted, so reports can be diffed.
+  SmallVector<const StringMapEntry<uint64_t>*, 8> Hits;
+  for (const StringMapEntry<uint64_t>& KV : PatternHits)
+    Hits.push_back(&KV);
+  llvm::sort(Hits, [] (auto* LHS, auto* RHS) {
+    return LHS->first() < RHS->first();
+  });
+  J.attributeObject("pattern_hits", [&] {
+    for (const StringMapEntry<uint64_t>* KV : Hits)
+      J.attribute(KV->first(), KV->second);
+  });
+}
@@ -0,0 +1,93 @@
+//===- driver/ModuleStats.hpp ---------------------------------------------===//
+//
+// Copyright (C) 2026 Ninefold
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file defines the ModuleStats struct, the counters written by
+/// `--stats-json` for each module.
+///
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "llvm/ADT/StringMap.h"
+#include "LLVM.hpp"
+#include <cstdint>
+#include <string>
+
+namespace llvm::json {
+class OStream;
+} // namespace llvm::json
+
+namespace debase_tool {
+
+/// What happened while handling a single module.
+struct ModuleStats {
+  /// The module name, as used for diagnostics.
+  std::string Name;
+  /// How the module was handled (debased, cached, skipped...).
+  StringRef Status = "failed";
+  /// Functions checked by the classifier.
+  uint64_t FunctionsScanned = 0;
+  /// Names which were actually demangled, rather than reused.
+  uint64_t NamesDemangled = 0;
+  /// Demangled names which couldn't be classified.
+  uint64_t DemangleFailures = 0;
+  /// Names which were classified as a ctor or dtor.
+  uint64_t CtorDtorCandidates = 0;
+  /// Matched functions skipped for being in a comdat.
+  uint64_t ComdatSkips = 0;
+  /// Functions which were debased.
+  uint64_t FunctionsDebased = 0;
+  /// Calls erased by debasing, including markers.
+  uint64_t CallsRemoved = 0;
+  /// Every instruction erased, including cleanup and `--strip-dead`.
+  uint64_t InstructionsErased = 0;
+  /// Definitions removed by `--strip-dead`.
+  uint64_t DeadFunctions = 0;
+  uint64_t DeadGlobals = 0;
+  /// The allocated size of the removed globals.
+  uint64_t DeadGlobalBytes = 0;
+  uint64_t InputBytes = 0;
+  uint64_t OutputBytes = 0;
+  /// The most memory allocated while the module was alive. Measured for the
+  /// whole process, so includes other workers with `-j`.
+  uint64_t PeakMemory = 0;
+  /// The memory allocated by the process when last sampled.
+  uint64_t ProcessMemory = 0;
+  /// If the module was the first in its `LLVMContext`.
+  uint64_t ContextsCreated = 0;
+  /// The modules loaded into the context so far, including this one.
+  uint64_t ContextModules = 0;
+  /// Matched functions for each pattern, by source.
+  llvm::StringMap<uint64_t> PatternHits;
+
+public:
+  /// Starts measuring memory from the current usage.
+  void startMemory();
+  /// Updates `PeakMemory` with the current usage.
+  void sampleMemory();
+  /// Adds the counters of `Other` to this, for totals.
+  void add(const ModuleStats& Other);
+  /// Writes the counters as a JSON object.
+  void print(llvm::json::OStream& J) const;
+
+private:
+  uint64_t MemoryBaseline = 0;
+};
+
+} // namespace debase_tool
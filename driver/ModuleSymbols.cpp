@@ -0,0 +1,63 @@
+//===- driver/ModuleSymbols.cpp -------------------------------------------===//
+//
+// Copyright (C) 2026 Ninefold
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// Reads the symbols of a bitcode module without building a `Module`.
+///
+//===----------------------------------------------------------------------===//
+
+#include "ModuleSymbols.hpp"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Object/IRSymtab.h"
+
+using namespace debase_tool;
+using namespace llvm;
+
+std::optional<ModuleSymbols> debase_tool::ReadModuleSymbols(MemoryBufferRef Buf) {
+  const auto* Begin = reinterpret_cast<const unsigned char*>(Buf.getBufferStart());
+  const auto* End = reinterpret_cast<const unsigned char*>(Buf.getBufferEnd());
+  if (!isBitcode(Begin, End))
+    return std::nullopt;
+  // Only reads the top level blocks, skipping the modules themselves.
+  Expected<BitcodeFileContents> BFCOrErr = getBitcodeFileContents(Buf);
+  if (!BFCOrErr) {
+    consumeError(BFCOrErr.takeError());
+    return std::nullopt;
+  }
+  const BitcodeFileContents& BFC = *BFCOrErr;
+  if (BFC.Mods.empty() || BFC.StrtabForSymtab.empty() ||
+      BFC.Symtab.size() < sizeof(irsymtab::storage::Header))
+    return std::nullopt;
+  // `irsymtab::readBitcode` would rebuild an old table by parsing the module,
+  // which is exactly what we're avoiding. Names are valid in any version with
+  // the same layout, so only the version is checked.
+  auto* Hdr = reinterpret_cast<const irsymtab::storage::Header*>(
+    BFC.Symtab.data());
+  if (Hdr->Version != irsymtab::storage::Header::kCurrentVersion)
+    return std::nullopt;
+
+  irsymtab::Reader R(BFC.Symtab, BFC.StrtabForSymtab);
+  ModuleSymbols Out;
+  Out.Triple = R.getTargetTriple();
+  Out.SourceFileName = R.getSourceFileName();
+  for (const irsymtab::Reader::SymbolRef& Sym : R.symbols()) {
+    StringRef Name = Sym.getIRName();
+    Out.Names.push_back(Name.empty() ? Sym.getName() : Name);
+  }
+  return Out;
+}
@@ -0,0 +1,48 @@
+//===- driver/ModuleSymbols.hpp -------------------------------------------===//
+//
+// Copyright (C) 2026 Ninefold
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// Reads the symbols of a bitcode module without building a `Module`.
+///
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MemoryBufferRef.h"
+#include "LLVM.hpp"
+#include <optional>
+
+namespace debase_tool {
+
+/// The symbols of a module, pointing into its buffer.
+struct ModuleSymbols {
+  /// The target triple recorded with the symbols.
+  StringRef Triple;
+  /// The source filename of the first module.
+  StringRef SourceFileName;
+  /// The IR name of every symbol, including declarations.
+  SmallVector<StringRef, 0> Names;
+};
+
+/// Reads the symbol table of a bitcode file. Returns nothing if the file isn't
+/// bitcode, or was written without a usable symbol table.
+std::optional<ModuleSymbols> ReadModuleSymbols(llvm::MemoryBufferRef Buf);
+
+} // namespace debase_tool
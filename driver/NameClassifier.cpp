@@ -64,6 +64,19 @@ using MDemangler = llvm::ms_demangle::Demangler;
 
 void Classifier::anchor() {}
 
+void Classifier::classifyAll(ArrayRef<StringRef> Syms, SymbolFeaturesBatch& Out) {
+  SymbolFeatures Feats {};
+  for (StringRef Sym : Syms) {
+    if (!mayBeCtorDtor(Sym)) {
+      Feats.clear();
+      Out.push_back(SymbolKind::Other, Feats);
+      continue;
+    }
+    SymbolKind K = classify(Sym, &Feats);
+    Out.push_back(K, Feats);
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Itanium (gnu)
 
@@ -148,10 +161,11 @@ static void PrintNestedNameForFeatures(const Node* N, SymbolFeatures& Out, int D
 #endif // DEBUG_DUMP_X
 }
 
-static bool AddNestedNameToFeatures(Node* N, SmallVectorImpl<std::string>& Out) {
+static bool AddNestedNameToFeatures(Node* N, SmallVectorImpl<StringRef>& Out) {
   if (N->getKind() == NodeKind::KNameType) {
+    // Names reference the mangled string, no copy needed.
     std::string_view Name = static_cast<NameType*>(N)->getName();
-    Out.emplace_back(std::string(Name));
+    Out.emplace_back(Name);
     return true;
   } else if (N->getKind() != NodeKind::KNestedName)
     // Unsupported name type
@@ -295,14 +309,45 @@ static SymbolKind ClassifyFunction(
 } // namespace gnu
 } // namespace `anonymous`
 
-SymbolKind ItaniumClassifier::classify(const std::string& Sym, SymbolFeatures* Out) {
+bool ItaniumClassifier::mayBeCtorDtor(StringRef Sym) const {
+  // Same prefixes accepted by the demangler.
+  if (!Sym.consume_front("_Z") && !Sym.consume_front("__Z"))
+    return false;
+  // Look for any <ctor-dtor-name> production:
+  //  C1 | C2 | C3 | C4 | C5 | CI1 <type> | CI2 <type>
+  //  D0 | D1 | D2 | D4 | D5
+  for (size_t I = Sym.find_first_of("CD"); I != StringRef::npos;
+              I = Sym.find_first_of("CD", I + 1)) {
+    StringRef Tail = Sym.drop_front(I + 1);
+    if (Tail.empty())
+      break;
+    if (Sym[I] == 'D') {
+      if (Tail[0] >= '0' && Tail[0] <= '5')
+        return true;
+    } else if (Tail[0] >= '1' && Tail[0] <= '5')
+      return true;
+    else if (Tail.starts_with("I1") || Tail.starts_with("I2"))
+      return true;
+  }
+  return false;
+}
+
+struct ItaniumClassifier::Parser : public IDemangler {
+  Parser() : IDemangler(nullptr, nullptr) {}
+};
+
+ItaniumClassifier::ItaniumClassifier() : TheParser(new Parser) {}
+ItaniumClassifier::~ItaniumClassifier() = default;
+
+SymbolKind ItaniumClassifier::classify(StringRef Sym, SymbolFeatures* Out) {
   using namespace llvm::itanium_demangle;
   if (Out)
     Out->clear();
   if (Sym.empty())
     return SymbolKind::Invalid;
-  std::string_view SymL = Sym;
-  IDemangler D(&*SymL.begin(), &*SymL.end());
+  // Reuses the previous arena, freeing nodes from the last symbol.
+  IDemangler& D = *TheParser;
+  D.reset(Sym.begin(), Sym.end());
   Node* AST = D.parse(/*ParseParams=*/false);
   if (AST == nullptr)
     // Print error?
@@ -489,10 +534,12 @@ void NameGetter::addToNameParts(ArrayRef<Node*> QualName) {
   }
 }
 
-static std::string GetNamePart(Node* Part) {
+/// Gets the name of `Part`. Names may be owned by the demangler, so they are
+/// copied into the arena of `Out`.
+static StringRef GetNamePart(Node* Part, SymbolFeatures& Out) {
   EmbeddedStringView EName = NameGetter::GetRealNamePart(Part);
   if (auto* Name = EName.getPointer())
-    return std::string(*Name);
+    return Out.save(*Name);
   return "!";
 }
 
@@ -568,15 +615,15 @@ static SymbolKind ClassifyFunction(
       Out->SymKind = K;
       for (Node* Nested : QualName.drop_back(BName ? 1 : 0)) {
         assert(Nested != nullptr && "Invalid QualName value?");
-        Out->addNested(GetNamePart(Nested));
+        Out->addNested(GetNamePart(Nested, *Out));
       }
       if (!BName)
         //Out->BaseName = GetNamePart(LastNode);
-        Out->setBase(GetNamePart(LastNode));
+        Out->setBase(GetNamePart(LastNode, *Out));
       else
         // Manually specified name pointer.
         //Out->BaseName = *BName;
-        Out->setBase(*BName);
+        Out->setBase(Out->save(*BName));
     }
 #if DEBUG_DUMP
     DumpInfo();
@@ -610,7 +657,16 @@ static SymbolKind ClassifyFunction(
 } // namespace msvc
 } // namespace `anonymous`
 
-SymbolKind MSVCClassifier::classify(const std::string& Sym, SymbolFeatures* Out) {
+bool MSVCClassifier::mayBeCtorDtor(StringRef Sym) const {
+  Sym.consume_front("\1");
+  // `??0` is a constructor, `??1` is a destructor. Templated ones are
+  // `??$?0` and `??$?1`.
+  if (Sym.consume_front("??$"))
+    return Sym.starts_with("?0") || Sym.starts_with("?1");
+  return Sym.starts_with("??0") || Sym.starts_with("??1");
+}
+
+SymbolKind MSVCClassifier::classify(StringRef Sym, SymbolFeatures* Out) {
   using namespace llvm::ms_demangle;
   if (Out)
     Out->clear();
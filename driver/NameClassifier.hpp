@@ -24,11 +24,13 @@
 #pragma once
 
 #include "LLVM.hpp"
+#include <memory>
 #include <string>
 
 namespace debase_tool {
 
 struct SymbolFeatures;
+struct SymbolFeaturesBatch;
 
 enum class SymbolKind {
   Invalid,
@@ -41,26 +43,40 @@ enum class SymbolKind {
 /// Classifies symbols.
 class Classifier {
 public:
-  virtual SymbolKind classify(const std::string& Sym, SymbolFeatures* Out) = 0;
-  SymbolKind classify(const std::string& Sym) { return classify(Sym, nullptr); }
+  virtual SymbolKind classify(StringRef Sym, SymbolFeatures* Out) = 0;
+  SymbolKind classify(StringRef Sym) { return classify(Sym, nullptr); }
+  /// Cheap lexical check for if `Sym` could be a constructor or destructor.
+  /// May have false positives, but never false negatives.
+  virtual bool mayBeCtorDtor(StringRef Sym) const = 0;
   virtual bool isMSVC() const = 0;
+  /// Classifies every symbol in `Syms`, appending the results to `Out`.
+  /// Demangler state is reused between symbols where possible.
+  void classifyAll(ArrayRef<StringRef> Syms, SymbolFeaturesBatch& Out);
+  virtual ~Classifier() = default;
 private:
   virtual void anchor();
 };
 
 /// Classifies symbols from the Itanium ABI.
 class ItaniumClassifier final : public Classifier {
+  struct Parser;
+  /// The parser and its arena, reset between symbols.
+  std::unique_ptr<Parser> TheParser;
 public:
-  SymbolKind classify(const std::string& Sym, SymbolFeatures* Out) override;
-  SymbolKind classify(const std::string& Sym) { return classify(Sym, nullptr); }
+  ItaniumClassifier();
+  ~ItaniumClassifier() override;
+  SymbolKind classify(StringRef Sym, SymbolFeatures* Out) override;
+  SymbolKind classify(StringRef Sym) { return classify(Sym, nullptr); }
+  bool mayBeCtorDtor(StringRef Sym) const override;
   bool isMSVC() const override { return false; }
 };
 
 /// Classifies symbols from the Microsoft ABI.
 class MSVCClassifier final : public Classifier {
 public:
-  SymbolKind classify(const std::string& Sym, SymbolFeatures* Out) override;
-  SymbolKind classify(const std::string& Sym) { return classify(Sym, nullptr); }
+  SymbolKind classify(StringRef Sym, SymbolFeatures* Out) override;
+  SymbolKind classify(StringRef Sym) { return classify(Sym, nullptr); }
+  bool mayBeCtorDtor(StringRef Sym) const override;
   bool isMSVC() const override { return true; }
 };
 
@@ -31,6 +31,7 @@
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/StringSwitch.h"
+#include "llvm/ADT/bit.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/StringSaver.h"
@@ -39,6 +40,10 @@
 #include "FilePropertyCache.hpp"
 #include "NameClassifier.hpp"
 #include "SymbolFeatures.hpp"
+#if defined(__SSE2__) || defined(_M_X64)
+# include <emmintrin.h>
+# define DEBASE_LEX_SSE2 1
+#endif
 
 using namespace debase_tool;
 using namespace llvm;
@@ -113,7 +118,7 @@ static bool IsValidPOSIXMetaclass(StringRef CC) {
 // Pattern
 //============================================================================//
 
-bool SimplePattern::match(ArrayRef<std::string> Names) const {
+bool SimplePattern::match(ArrayRef<StringRef> Names) const {
   if (requiredCount() != Names.size())
     return false;
   auto Patterns = getPatterns();
@@ -123,7 +128,7 @@ bool SimplePattern::match(ArrayRef<std::string> Names) const {
   return true;
 }
 
-bool LeadingSimplePattern::match(ArrayRef<std::string> Names) const {
+bool LeadingSimplePattern::match(ArrayRef<StringRef> Names) const {
   if (requiredCount() >= Names.size())
     return false;
   auto Patterns = getPatterns();
@@ -133,7 +138,7 @@ bool LeadingSimplePattern::match(ArrayRef<std::string> Names) const {
   return true;
 }
 
-bool SingleSequencePattern::match(ArrayRef<std::string> Names) const {
+bool SingleSequencePattern::match(ArrayRef<StringRef> Names) const {
   auto Patterns = getPatterns();
   if (Patterns.size() != Names.size())
     return false;
@@ -154,7 +159,7 @@ AnySequencePattern::AnySequencePattern(ArrayRef<Pattern*> Patterns)
   }
 }
 
-bool AnySequencePattern::match(ArrayRef<std::string> Names) const {
+bool AnySequencePattern::match(ArrayRef<StringRef> Names) const {
   if (Names.size() < RealCount)
     return false;
   for (Pattern* P : getPatterns()) {
@@ -173,7 +178,7 @@ bool AnySequencePattern::match(ArrayRef<std::string> Names) const {
   return true;
 }
 
-bool LeadingGlobPattern::match(ArrayRef<std::string> Names) const {
+bool LeadingGlobPattern::match(ArrayRef<StringRef> Names) const {
   assert(!Names.empty() && "Invalid glob input");
   const unsigned Count = Trailing->count();
   if (Names.size() < Count)
@@ -186,7 +191,7 @@ bool LeadingGlobPattern::match(ArrayRef<std::string> Names) const {
            Names.take_back(Count));
 }
 
-bool ButterflyGlobPattern::match(ArrayRef<std::string> Names) const {
+bool ButterflyGlobPattern::match(ArrayRef<StringRef> Names) const {
   assert(!Names.empty() && "Invalid glob input");
   const unsigned LeadingCount = Leading->count(),
                  TrailingCount = Trailing->count();
@@ -198,6 +203,150 @@ bool ButterflyGlobPattern::match(ArrayRef<std::string> Names) const {
     Names.take_back(TrailingCount));
 }
 
+namespace {
+/// A single atom of the regex flavor, eg. `a`, `[A-Z]*`.
+struct RegexAtom {
+  /// A literal character, or a character class.
+  StringRef Text;
+  /// One of `?*+`, or none.
+  char Quant = '\0';
+public:
+  bool isClass() const { return Text.size() > 1; }
+  bool isOptional() const { return Quant == '?' || Quant == '*'; }
+};
+} // namespace `anonymous`
+
+static bool IsQuantifier(char C) {
+  return C == '?' || C == '*' || C == '+';
+}
+
+/// Checks if `C` is a literal atom. `$` is an identifier character, but an
+/// anchor to `llvm::Regex`, so it's left unlowered.
+static bool IsLiteralAtom(char C) {
+  return Character::isIdentifier(C) && C != '$';
+}
+
+/// Splits `RegExp` into atoms, returning false for shapes we don't lower.
+static bool SplitRegexAtoms(StringRef RegExp, SmallVectorImpl<RegexAtom>& Out) {
+  while (!RegExp.empty()) {
+    const char C = RegExp.front();
+    if (C == '(') {
+      // Inserted properties, eg. `(Foo)`.
+      const size_t End = RegExp.find(')');
+      if (End == StringRef::npos)
+        return false;
+      StringRef Group = RegExp.slice(1, End);
+      RegExp = RegExp.drop_front(End + 1);
+      if (!llvm::all_of(Group, IsLiteralAtom))
+        return false;
+      if (!RegExp.empty() && IsQuantifier(RegExp.front()))
+        return false;
+      for (size_t I = 0, E = Group.size(); I != E; ++I)
+        Out.push_back({Group.substr(I, 1)});
+      continue;
+    }
+
+    RegexAtom Atom;
+    if (C == '[') {
+      const size_t End = RegExp.find(']');
+      // Skip POSIX metaclasses.
+      if (End == StringRef::npos || RegExp.take_front(End).contains("[:"))
+        return false;
+      Atom.Text = RegExp.take_front(End + 1);
+    } else if (IsLiteralAtom(C))
+      Atom.Text = RegExp.take_front(1);
+    else
+      return false;
+    RegExp = RegExp.drop_front(Atom.Text.size());
+
+    if (!RegExp.empty() && IsQuantifier(RegExp.front())) {
+      Atom.Quant = RegExp.front();
+      RegExp = RegExp.drop_front();
+      // Lazy quantifiers, eg. `*?`.
+      if (!RegExp.empty() && IsQuantifier(RegExp.front()))
+        return false;
+    }
+    Out.push_back(Atom);
+  }
+  return true;
+}
+
+/// Converts a validated character class into a set.
+static std::bitset<256> ExpandCharacterClass(StringRef CC) {
+  assert(CC.front() == '[' && CC.back() == ']');
+  std::bitset<256> Set;
+  CC = CC.drop_front().drop_back();
+  const bool Negated = CC.consume_front("^");
+  for (size_t I = 0, E = CC.size(); I != E; ++I) {
+    if (I + 2 < E && CC[I + 1] == '-') {
+      const unsigned First = static_cast<unsigned char>(CC[I]),
+                     Last = static_cast<unsigned char>(CC[I + 2]);
+      for (unsigned C = First; C <= Last; ++C)
+        Set.set(C);
+      I += 2;
+      continue;
+    }
+    Set.set(static_cast<unsigned char>(CC[I]));
+  }
+  if (Negated)
+    Set.flip();
+  return Set;
+}
+
+RegexPattern::Compiled::Compiled(StringRef RegExp) {
+  SmallVector<RegexAtom, 16> Atoms;
+  if (!SplitRegexAtoms(RegExp, Atoms)) {
+    this->RegExp.emplace(RegExp);
+    return;
+  }
+
+  // `llvm::Regex::match` searches instead of matching the whole name, so
+  // optional atoms at either end never change the result, and `X+` at either
+  // end matches wherever `X` does.
+  auto Begin = llvm::find_if_not(Atoms, [](const RegexAtom& A) {
+    return A.isOptional();
+  });
+  Atoms.erase(Atoms.begin(), Begin);
+  while (!Atoms.empty() && Atoms.back().isOptional())
+    Atoms.pop_back();
+  if (Atoms.empty()) {
+    this->Lowered = LKAlways;
+    return;
+  }
+  Atoms.front().Quant = '\0';
+  Atoms.back().Quant = '\0';
+
+  if (Atoms.size() == 1 && Atoms[0].isClass()) {
+    this->Lowered = LKAnyOf;
+    this->CharSet = ExpandCharacterClass(Atoms[0].Text);
+    return;
+  }
+  const bool IsLiteral = llvm::all_of(Atoms, [](const RegexAtom& A) {
+    return !A.isClass() && A.Quant == '\0';
+  });
+  if (IsLiteral) {
+    this->Lowered = LKContains;
+    for (const RegexAtom& A : Atoms)
+      this->Literal.append(A.Text);
+    return;
+  }
+  // General case.
+  this->RegExp.emplace(RegExp);
+}
+
+void RegexPattern::replace(StringRef RegExp) {
+  for (auto& [Source, C] : Cache) {
+    if (Source == RegExp) {
+      Active = C.get();
+      return;
+    }
+  }
+  if (Cache.size() == kCacheSize)
+    Cache.erase(Cache.begin());
+  Cache.emplace_back(RegExp.str(), std::make_unique<Compiled>(RegExp));
+  Active = Cache.back().second.get();
+}
+
 // Replacer
 
 /// Parses tokens into a replacement vector.
@@ -245,10 +394,13 @@ Error FmtReplacer::replace(llvm::BumpPtrAllocator& BP, FilePropertyCache& C) {
       Format.append(StringRef(RP.Lit, RP.Size));
   }
   
-  StringRef ToReplace = Format.str();
-  if (!this->isRegex())
-    ToReplace = InternStringRef(BP, ToReplace);
-  this->replaceData(ToReplace);
+  // Nothing this depends on has changed.
+  if (HasValue && Format == LastValue)
+    return Error::success();
+  // Patterns may reference this until the next change.
+  LastValue = Format;
+  HasValue = true;
+  this->replaceData(LastValue.str());
   return Error::success();
 }
 
@@ -315,6 +467,44 @@ void RegexPattern::print(raw_ostream& OS) const {
 // PatternLex
 //============================================================================//
 
+bool debase_tool::LexLiteralFastPath = true;
+
+/// Checks if `C` can be in a literal run of `a::b::C`.
+static bool IsLiteralChar(char C) {
+  return Character::isIdentifier(C) || C == ':';
+}
+
+/// Returns the index of the first character which isn't `[0-9a-zA-Z_$:]`,
+/// or the size of `S`. Checks 16 characters at a time where possible.
+static size_t FindNonLiteral(StringRef S) {
+  const char* const Begin = S.data();
+  const char* At = Begin;
+  const char* const End = Begin + S.size();
+#if DEBASE_LEX_SSE2
+  // Bytes are signed, so anything past ASCII fails every range check.
+  auto InRange = [] (__m128i V, char Lo, char Hi) {
+    return _mm_and_si128(_mm_cmpgt_epi8(V, _mm_set1_epi8(Lo - 1)),
+                         _mm_cmplt_epi8(V, _mm_set1_epi8(Hi + 1)));
+  };
+  for (; End - At >= 16; At += 16) {
+    const __m128i V = _mm_loadu_si128(reinterpret_cast<const __m128i*>(At));
+    // `[0-9:]` is contiguous, and `| 0x20` folds upper into lower case.
+    __m128i Ok = InRange(V, '0', ':');
+    Ok = _mm_or_si128(Ok,
+      InRange(_mm_or_si128(V, _mm_set1_epi8(0x20)), 'a', 'z'));
+    Ok = _mm_or_si128(Ok, _mm_cmpeq_epi8(V, _mm_set1_epi8('_')));
+    Ok = _mm_or_si128(Ok, _mm_cmpeq_epi8(V, _mm_set1_epi8('$')));
+    const unsigned Mask = unsigned(_mm_movemask_epi8(Ok));
+    if (Mask != 0xFFFF)
+      return (At - Begin) + llvm::countr_one(Mask);
+  }
+#endif
+  for (; At != End; ++At)
+    if (!IsLiteralChar(*At))
+      break;
+  return At - Begin;
+}
+
 namespace {
 
 /// Implements lexing for patterns.
@@ -346,6 +536,9 @@ public:
   Error lexImpl();
   /// Handles simple identifiers.
   Error handleSimple();
+  /// Tokenizes the leading run of literal segments without splitting them
+  /// one at a time. Anything unusual is left for `handleSimple`.
+  void handleLiteralRun();
   /// Identifies `@` or `**`, otherwise `KUnknown`.
   inline Token::Kind identifyStandalone() const;
   /// Returns if last token was `**`.
@@ -594,7 +787,29 @@ Error PatternLexer::lexImpl() {
   return Error::success();
 }
 
+void PatternLexer::handleLiteralRun() {
+  StringRef Run = Pat.take_front(FindNonLiteral(Pat));
+  const bool RunsToEnd = (Run.size() == Pat.size());
+  while (!Run.empty()) {
+    const size_t Sep = Run.find("::");
+    if (Sep == StringRef::npos && !RunsToEnd)
+      // The segment continues past the run.
+      return;
+    StringRef Seg = Run.take_front(Sep);
+    // Let the scalar path report or handle these.
+    if (Seg.empty() || Seg.contains(':') || llvm::isDigit(Seg.front()))
+      return;
+    Curr = Seg;
+    this->tok(Token::KSimple);
+    const size_t Skip = (Sep == StringRef::npos) ? Seg.size() : Sep + 2;
+    Run = Run.drop_front(Skip);
+    Pat = Pat.drop_front(Skip);
+  }
+}
+
 Error PatternLexer::handleSimple() {
+  if (LexLiteralFastPath)
+    handleLiteralRun();
   while (true) {
     if (!loadNextToken())
       return Error::success();
@@ -24,14 +24,19 @@
 #pragma once
 
 #include "llvm/ADT/PointerSumType.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/Regex.h"
 #include "llvm/Support/TrailingObjects.h"
 #include "LLVM.hpp"
 #include "SymbolFeatures.hpp"
+#include <bitset>
 #include <concepts>
+#include <memory>
 #include <optional>
+#include <string>
 
 #undef LLVM_ENABLE_DUMP
 #define LLVM_ENABLE_DUMP 1
@@ -91,7 +96,7 @@ protected:
 
 public:
   /// Dispatches to type specific match functions.
-  inline bool matchSymbol(ArrayRef<std::string> Syms) const;
+  inline bool matchSymbol(ArrayRef<StringRef> Syms) const;
   /// Returns the kind of `this`.
   PatternKind kind() const { return this->Kind; }
   /// Returns the pattern count.
@@ -131,7 +136,7 @@ public:
         && K != PatternKind::Regex;
   }
   /// Match against a (possibly partial) set of features.
-  virtual bool match(ArrayRef<std::string> Names) const = 0;
+  virtual bool match(ArrayRef<StringRef> Names) const = 0;
   /// Match against a set of features.
   LLVM_ATTRIBUTE_ALWAYS_INLINE bool match(this auto& self,
                                           const SymbolFeatures& F) {
@@ -213,7 +218,7 @@ private:
   void anchor() override;
 };
 
-bool Pattern::matchSymbol(ArrayRef<std::string> Syms) const {
+bool Pattern::matchSymbol(ArrayRef<StringRef> Syms) const {
   if (LLVM_UNLIKELY(Syms.empty()))
     return false;
   if (auto* SP = dyn_cast<SinglePattern>(this)) {
@@ -235,7 +240,9 @@ class SimplePattern final
   PATTERN_TRAILING(Simple, StringRef)
 public:
   PATTERN_CLASSOF(PatternKind::Simple)
-  bool match(ArrayRef<std::string> Names) const override;
+  bool match(ArrayRef<StringRef> Names) const override;
+  /// Returns the literal names to match against.
+  ArrayRef<StringRef> literals() const { return getPatterns(); }
   void print(raw_ostream& OS) const override;
 };
 
@@ -248,7 +255,9 @@ class LeadingSimplePattern final
   PATTERN_TRAILING(LeadingSimple, StringRef)
 public:
   PATTERN_CLASSOF(PatternKind::LeadingSimple)
-  bool match(ArrayRef<std::string> Names) const override;
+  bool match(ArrayRef<StringRef> Names) const override;
+  /// Returns the literal names to match against.
+  ArrayRef<StringRef> literals() const { return getPatterns(); }
   void print(raw_ostream& OS) const override;
 };
 
@@ -260,7 +269,7 @@ class SingleSequencePattern final
   PATTERN_TRAILING(SingleSequence, SinglePattern*)
 public:
   PATTERN_CLASSOF(PatternKind::SingleSequence)
-  bool match(ArrayRef<std::string> Names) const override;
+  bool match(ArrayRef<StringRef> Names) const override;
   void print(raw_ostream& OS) const override;
 };
 
@@ -274,7 +283,7 @@ class AnySequencePattern final
   AnySequencePattern(ArrayRef<Pattern*> Patterns);
 public:
   PATTERN_CLASSOF(PatternKind::AnySequence)
-  bool match(ArrayRef<std::string> Names) const override;
+  bool match(ArrayRef<StringRef> Names) const override;
   void print(raw_ostream& OS) const override;
   unsigned requiredCount() const override final { return RealCount; }
 };
@@ -287,7 +296,7 @@ class ForwardingPattern final : public MultiPattern {
    : MultiPattern(PatternKind::Forwarding, 1), ThePattern(P) {}
 public:
   PATTERN_CLASSOF(PatternKind::Forwarding)
-  bool match(ArrayRef<std::string> Names) const override {
+  bool match(ArrayRef<StringRef> Names) const override {
     if (LLVM_UNLIKELY(Names.size() != 1))
       return false;
     return ThePattern->match(StringRef(Names[0]));
@@ -323,8 +332,9 @@ protected:
   }
 public:
   PATTERN_CLASSOF(PatternKind::LeadingGlob)
-  bool match(ArrayRef<std::string> Names) const override;
+  bool match(ArrayRef<StringRef> Names) const override;
   void print(raw_ostream& OS) const override;
+  const MultiPattern* trailing() const { return Trailing; }
   unsigned requiredCount() const override { return Trailing->requiredCount(); }
 };
 
@@ -342,8 +352,10 @@ protected:
   }
 public:
   PATTERN_CLASSOF(PatternKind::ButterflyGlob)
-  bool match(ArrayRef<std::string> Names) const override;
+  bool match(ArrayRef<StringRef> Names) const override;
   void print(raw_ostream& OS) const override;
+  const MultiPattern* leading() const { return Leading; }
+  const MultiPattern* trailing() const { return Trailing; }
   unsigned requiredCount() const override {
     return Leading->requiredCount() + Trailing->requiredCount();
   }
@@ -383,24 +395,68 @@ private:
 };
 
 /// Matches against a regular expression.
+/// Common shapes are lowered to simple string checks, leaving `llvm::Regex`
+/// for the general case.
 class RegexPattern final : public SinglePattern {
   friend class SymbolMatcher;
   template <class> friend class ReplacerStorage;
-  std::optional<llvm::Regex> RegExp;
+public:
+  /// How the expression is matched.
+  enum LoweredKind : unsigned char {
+    LKRegex,    // Uses `llvm::Regex`.
+    LKAlways,   // Only optional atoms, eg. `I?`.
+    LKContains, // Literal, eg. `Foo`, `Foo.*`, `.*Impl`.
+    LKAnyOf,    // Single character class, eg. `[A-C]`.
+  };
+
+  /// A compiled expression.
+  struct Compiled {
+    LoweredKind Lowered = LKRegex;
+    std::optional<llvm::Regex> RegExp;
+    /// The literal for `LKContains`.
+    SmallString<16> Literal;
+    /// The characters for `LKAnyOf`.
+    std::bitset<256> CharSet;
+  public:
+    Compiled(StringRef RegExp);
+    bool match(StringRef Name) const {
+      switch (Lowered) {
+      case LKAlways:
+        return true;
+      case LKContains:
+        return Name.contains(Literal);
+      case LKAnyOf:
+        return llvm::any_of(Name, [this](char C) {
+          return CharSet.test(static_cast<unsigned char>(C));
+        });
+      default:
+        return RegExp->match(Name);
+      }
+    }
+  };
+
+private:
+  /// Max amount of expressions kept in `Cache`.
+  static constexpr unsigned kCacheSize = 4;
+  /// Recently compiled expressions, keyed on their source. Replacements often
+  /// alternate between a few values, so this avoids recompiling them.
+  SmallVector<std::pair<std::string, std::unique_ptr<Compiled>>, 1> Cache;
+  /// The expression currently in use.
+  const Compiled* Active = nullptr;
 protected:
   RegexPattern() : SinglePattern(PatternKind::Regex) {}
-  RegexPattern(StringRef RegExp)
-   : SinglePattern(PatternKind::Regex), RegExp(RegExp) {
+  RegexPattern(StringRef RegExp) : SinglePattern(PatternKind::Regex) {
     assert(!RegExp.empty());
+    this->replace(RegExp);
   }
 public:
   PATTERN_CLASSOF(PatternKind::Regex)
-  void replace(StringRef RegExp) {
-    this->RegExp.emplace(RegExp);
-  }
+  void replace(StringRef RegExp);
   bool match(StringRef Name) const override {
-    return RegExp->match(Name);
+    return Active->match(Name);
   }
+  /// Returns how the expression is matched.
+  LoweredKind getLoweredKind() const { return Active->Lowered; }
   void print(raw_ostream& OS) const override;
 private:
   void anchor() override;
@@ -453,6 +509,9 @@ class FmtReplacer : public Replacer {
   };
   // Add format object.
   SmallVector<ReplacerPiece, 2> Pieces;
+  /// The last formatted value, replacements are skipped if it's unchanged.
+  SmallString<32> LastValue;
+  bool HasValue = false;
   /// Parses tokens into a replacement vector.
   static SmallVector<ReplacerPiece, 2>
    ParseToks(ArrayRef<Pattern::Token> Toks);
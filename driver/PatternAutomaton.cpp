@@ -0,0 +1,166 @@
+//===- driver/PatternAutomaton.cpp ----------------------------------------===//
+//
+// Copyright (C) 2026 Ninefold
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// Merges literal patterns into a single trie over name components.
+///
+//===----------------------------------------------------------------------===//
+
+#include "PatternAutomaton.hpp"
+#include "Pattern.hpp"
+#include "llvm/ADT/STLExtras.h"
+
+using namespace debase_tool;
+using namespace llvm;
+
+unsigned PatternAutomaton::getOrInsertChild(unsigned Parent, StringRef Name) {
+  auto [It, DidEmplace] =
+    Edges.try_emplace({Parent, GetNameKey(Name)}, Nodes.size());
+  if (DidEmplace) {
+    Nodes.emplace_back().Label = Name;
+    return It->second;
+  }
+  // Walk the collisions.
+  unsigned Cur = It->second;
+  while (true) {
+    if (Nodes[Cur].Label == Name)
+      return Cur;
+    if (Nodes[Cur].NextCollision == 0)
+      break;
+    Cur = Nodes[Cur].NextCollision;
+  }
+  const unsigned New = Nodes.size();
+  Nodes.emplace_back().Label = Name;
+  Nodes[Cur].NextCollision = New;
+  return New;
+}
+
+unsigned PatternAutomaton::getChild(unsigned Parent, StringRef Name,
+                                    NameKey Key) const {
+  auto It = Edges.find({Parent, Key});
+  if (It == Edges.end())
+    return 0;
+  for (unsigned Cur = It->second; Cur != 0; Cur = Nodes[Cur].NextCollision) {
+    if (LLVM_LIKELY(Nodes[Cur].Label == Name))
+      return Cur;
+  }
+  return 0;
+}
+
+unsigned PatternAutomaton::walkOrInsert(unsigned Root,
+                                        ArrayRef<StringRef> Names) {
+  unsigned Cur = Root;
+  for (StringRef Name : Names)
+    Cur = getOrInsertChild(Cur, Name);
+  return Cur;
+}
+
+unsigned PatternAutomaton::walkOrInsertBackwards(unsigned Root,
+                                                 ArrayRef<StringRef> Names) {
+  unsigned Cur = Root;
+  for (StringRef Name : llvm::reverse(Names))
+    Cur = getOrInsertChild(Cur, Name);
+  return Cur;
+}
+
+void PatternAutomaton::addGlob(ArrayRef<StringRef> Leading,
+                               ArrayRef<StringRef> Trailing) {
+  assert(!Trailing.empty() && "Invalid glob!");
+  const unsigned Lead = walkOrInsert(0, Leading);
+  if (Nodes[Lead].SuffixRoot == 0) {
+    const unsigned NewRoot = Nodes.size();
+    Nodes.emplace_back();
+    Nodes[Lead].SuffixRoot = NewRoot;
+  }
+  const unsigned Tail = walkOrInsertBackwards(Nodes[Lead].SuffixRoot, Trailing);
+  Nodes[Tail].Suffix = true;
+}
+
+void PatternAutomaton::addExact(ArrayRef<StringRef> Names) {
+  assert(!Names.empty() && "Invalid path!");
+  Nodes[walkOrInsert(0, Names)].Exact = true;
+}
+
+bool PatternAutomaton::add(const Pattern* P) {
+  if (auto* SP = dyn_cast<SimplePattern>(P)) {
+    addExact(SP->literals());
+    return true;
+  } else if (auto* LSP = dyn_cast<LeadingSimplePattern>(P)) {
+    Nodes[walkOrInsert(0, LSP->literals())].Prefix = true;
+    return true;
+  } else if (auto* LGP = dyn_cast<LeadingGlobPattern>(P)) {
+    auto* Trailing = dyn_cast<SimplePattern>(LGP->trailing());
+    if (!Trailing)
+      return false;
+    addGlob({}, Trailing->literals());
+    return true;
+  } else if (auto* BGP = dyn_cast<ButterflyGlobPattern>(P)) {
+    auto* Leading = dyn_cast<SimplePattern>(BGP->leading());
+    auto* Trailing = dyn_cast<SimplePattern>(BGP->trailing());
+    if (!Leading || !Trailing)
+      return false;
+    addGlob(Leading->literals(), Trailing->literals());
+    return true;
+  }
+  // Sequences, regexes and replacements must be checked individually.
+  return false;
+}
+
+bool PatternAutomaton::matchSuffix(unsigned Root, ArrayRef<StringRef> Names,
+                                   ArrayRef<NameKey> Keys) const {
+  unsigned Cur = Root;
+  for (size_t I = Names.size(); I != 0; --I) {
+    Cur = getChild(Cur, Names[I - 1], Keys[I - 1]);
+    if (Cur == 0)
+      return false;
+    if (Nodes[Cur].Suffix)
+      return true;
+  }
+  return false;
+}
+
+bool PatternAutomaton::match(ArrayRef<StringRef> Names) const {
+  SmallVector<NameKey, 8> Keys;
+  Keys.reserve(Names.size());
+  for (StringRef Name : Names)
+    Keys.push_back(GetNameKey(Name));
+  return match(Names, Keys);
+}
+
+bool PatternAutomaton::match(ArrayRef<StringRef> Names,
+                             ArrayRef<NameKey> Keys) const {
+  assert(Names.size() == Keys.size());
+  if (LLVM_UNLIKELY(Names.empty() || empty()))
+    return false;
+  unsigned Cur = 0;
+  for (unsigned Depth = 0, E = Names.size(); ; ++Depth) {
+    const Node& N = Nodes[Cur];
+    // Globs require the trailing part to come after the leading part.
+    if (N.SuffixRoot && matchSuffix(N.SuffixRoot, Names.drop_front(Depth),
+                                    Keys.drop_front(Depth)))
+      return true;
+    if (Depth == E)
+      return N.Exact;
+    // Leading patterns require at least one extra name.
+    if (N.Prefix)
+      return true;
+    Cur = getChild(Cur, Names[Depth], Keys[Depth]);
+    if (Cur == 0)
+      return false;
+  }
+}
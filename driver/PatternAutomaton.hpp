@@ -0,0 +1,96 @@
+//===- driver/PatternAutomaton.hpp ----------------------------------------===//
+//
+// Copyright (C) 2026 Ninefold
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// Merges literal patterns into a single trie over name components.
+///
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "LLVM.hpp"
+#include "SymbolFeatures.hpp"
+#include <utility>
+#include <vector>
+
+namespace debase_tool {
+
+class Pattern;
+
+/// A trie built from every literal pattern, matching in O(nesting depth).
+/// Prefixes are walked forwards from the root, and nodes which end the leading
+/// part of a glob hold the root of a trie walked backwards over the remaining
+/// names. `x::**::Z` is stored as `x` -> `{Z}`, `**::Z` as `root` -> `{Z}`.
+///
+/// Edges are keyed on the `NameKey` of each name, so most mismatches never
+/// compare the strings themselves.
+class PatternAutomaton {
+  struct Node {
+    /// The name of the edge leading here.
+    StringRef Label;
+    /// The next child of the same parent with a colliding key, 0 for none.
+    unsigned NextCollision = 0;
+    /// Root of the suffix trie for globs with this leading part, 0 for none.
+    unsigned SuffixRoot = 0;
+    /// A `SimplePattern` ends here.
+    bool Exact  : 1 = false;
+    /// A `LeadingSimplePattern` ends here.
+    bool Prefix : 1 = false;
+    /// The trailing part of a glob ends here (suffix nodes only).
+    bool Suffix : 1 = false;
+  };
+
+  using EdgeKey = std::pair<unsigned, NameKey>;
+  /// Node 0 is the forward root.
+  std::vector<Node> Nodes;
+  /// Edges of every node, keyed by the parent and name.
+  llvm::DenseMap<EdgeKey, unsigned> Edges;
+
+public:
+  PatternAutomaton() : Nodes(1) {}
+
+  /// Adds `P` if it can be represented, otherwise returns false.
+  bool add(const Pattern* P);
+  /// Adds a literal path, which must match all names.
+  void addExact(ArrayRef<StringRef> Names);
+  /// Adds a literal path, which must match the trailing names.
+  void addSuffix(ArrayRef<StringRef> Names) { addGlob({}, Names); }
+  /// Matches names against every pattern added.
+  bool match(ArrayRef<StringRef> Names) const;
+  /// Matches names against every pattern added, using precomputed keys.
+  bool match(ArrayRef<StringRef> Names, ArrayRef<NameKey> Keys) const;
+
+  /// Returns true if no patterns have been added.
+  bool empty() const { return Nodes.size() == 1; }
+  /// Returns the amount of nodes.
+  unsigned size() const { return Nodes.size(); }
+
+private:
+  unsigned getOrInsertChild(unsigned Parent, StringRef Name);
+  unsigned getChild(unsigned Parent, StringRef Name, NameKey Key) const;
+  unsigned walkOrInsert(unsigned Root, ArrayRef<StringRef> Names);
+  unsigned walkOrInsertBackwards(unsigned Root, ArrayRef<StringRef> Names);
+  bool matchSuffix(unsigned Root, ArrayRef<StringRef> Names,
+                   ArrayRef<NameKey> Keys) const;
+  void addGlob(ArrayRef<StringRef> Leading, ArrayRef<StringRef> Trailing);
+};
+
+} // namespace debase_tool
@@ -113,6 +113,10 @@ public:
   }
 };
 
+/// If literal runs such as `a::b::C` are lexed a block at a time. Only
+/// disabled to check the fast path against the scalar lexer.
+extern bool LexLiteralFastPath;
+
 /// Lexes `Token`s for a `Pattern` from `Pat`.
 /// @param Intern Function that returns a copy of the input string with a managed lifetime.
 llvm::Error lexTokensForPattern(StringRef Pat, SmallVectorImpl<Pattern::Token>& Toks,
@@ -0,0 +1,119 @@
+//===- driver/PhaseTimer.cpp ----------------------------------------------===//
+//
+// Copyright (C) 2026 Ninefold
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the phase timers. `llvm::Timer`s can't be shared
+/// between threads, so every scope adds its own `TimeRecord` to the totals.
+///
+//===----------------------------------------------------------------------===//
+
+#include "PhaseTimer.hpp"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/raw_ostream.h"
+#include <mutex>
+
+using namespace debase_tool;
+using namespace llvm;
+
+static constexpr unsigned NumPhases = unsigned(Phase::NumPhases);
+
+static constexpr StringRef PhaseNames[NumPhases] = {
+  "read", "magic", "archive", "symtab", "parseIR", "verify",
+  "classify", "match", "debaseFunctions", "resetFunctionAttrs",
+  "cleanup", "strip-dead", "writeLLVM",
+};
+
+static bool Enabled = false;
+static std::mutex TotalsLock;
+static TimeRecord Totals[NumPhases];
+static bool DidRun[NumPhases];
+/// The innermost phase on this thread.
+static thread_local PhaseScope* Current = nullptr;
+
+static void AddTime(Phase P, const TimeRecord& T) {
+  std::lock_guard Guard(TotalsLock);
+  Totals[unsigned(P)] += T;
+  DidRun[unsigned(P)] = true;
+}
+
+StringRef debase_tool::GetPhaseName(Phase P) {
+  assert(P != Phase::NumPhases && "Invalid phase!");
+  return PhaseNames[unsigned(P)];
+}
+
+void debase_tool::EnablePhaseTimes(bool Enable) {
+  std::lock_guard Guard(TotalsLock);
+  Enabled = Enable;
+  for (unsigned I = 0; I != NumPhases; ++I) {
+    Totals[I] = TimeRecord();
+    DidRun[I] = false;
+  }
+}
+
+bool debase_tool::ArePhaseTimesEnabled() {
+  return Enabled;
+}
+
+TimeRecord debase_tool::GetPhaseTime(Phase P) {
+  std::lock_guard Guard(TotalsLock);
+  return Totals[unsigned(P)];
+}
+
+void debase_tool::PrintPhaseTimes(raw_ostream& OS) {
+  StringMap<TimeRecord> Records;
+  {
+    std::lock_guard Guard(TotalsLock);
+    for (unsigned I = 0; I != NumPhases; ++I)
+      if (DidRun[I])
+        Records[PhaseNames[I]] = Totals[I];
+  }
+  if (Records.empty())
+    return;
+  TimerGroup TG("debase", "Debase phase times", Records);
+  TG.print(OS);
+}
+
+PhaseScope::PhaseScope(Phase P) : Trace(GetPhaseName(P)), P(P) {
+  if (!Enabled)
+    return;
+  Active = true;
+  Parent = Current;
+  if (Parent)
+    Parent->pause();
+  Current = this;
+  Start = TimeRecord::getCurrentTime(/*Start=*/true);
+}
+
+PhaseScope::~PhaseScope() {
+  if (!Active)
+    return;
+  pause();
+  Current = Parent;
+  if (Parent)
+    Parent->resume();
+}
+
+void PhaseScope::pause() {
+  TimeRecord Elapsed = TimeRecord::getCurrentTime(/*Start=*/false);
+  Elapsed -= Start;
+  AddTime(P, Elapsed);
+}
+
+void PhaseScope::resume() {
+  Start = TimeRecord::getCurrentTime(/*Start=*/true);
+}
@@ -0,0 +1,83 @@
+//===- driver/PhaseTimer.hpp ----------------------------------------------===//
+//
+// Copyright (C) 2026 Ninefold
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// Times each phase of the driver across every worker, and adds them to the
+/// time trace when one is being recorded.
+///
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/Timer.h"
+#include "LLVM.hpp"
+
+namespace debase_tool {
+
+enum class Phase : unsigned {
+  Read,
+  Magic,
+  Archive,
+  Symtab,
+  Parse,
+  Verify,
+  Classify,
+  Match,
+  Debase,
+  ResetAttrs,
+  Cleanup,
+  StripDead,
+  Write,
+  NumPhases
+};
+
+/// Returns the name of `P`, as shown in the table and trace.
+StringRef GetPhaseName(Phase P);
+
+/// Starts or stops collecting phase times, clearing the totals. Must be
+/// called before any workers start.
+void EnablePhaseTimes(bool Enable = true);
+/// Returns if phase times are being collected.
+bool ArePhaseTimesEnabled();
+/// Returns the total time spent in `P` by every thread.
+llvm::TimeRecord GetPhaseTime(Phase P);
+/// Prints the totals of every phase which ran, like `-time-passes`.
+void PrintPhaseTimes(raw_ostream& OS);
+
+/// Times a phase for as long as it's in scope. Nested phases are excluded
+/// from their parent, so the totals never overlap.
+class PhaseScope {
+  llvm::TimeTraceScope Trace;
+  PhaseScope* Parent = nullptr;
+  llvm::TimeRecord Start;
+  Phase P;
+  bool Active = false;
+
+public:
+  PhaseScope(Phase P);
+  ~PhaseScope();
+  PhaseScope(const PhaseScope&) = delete;
+  PhaseScope& operator=(const PhaseScope&) = delete;
+
+private:
+  void pause();
+  void resume();
+};
+
+} // namespace debase_tool
@@ -0,0 +1,153 @@
+//===- driver/Server.cpp --------------------------------------------------===//
+//
+// Copyright (C) 2026 Ninefold
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the request loop used by `--serve`.
+///
+//===----------------------------------------------------------------------===//
+
+#include "Server.hpp"
+#include "Shared.hpp"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/WithColor.h"
+#include "llvm/Support/raw_socket_stream.h"
+#include <iostream>
+
+using namespace debase_tool;
+using namespace llvm;
+
+/// Parses a request, or sets `Shutdown` if the server should stop.
+static Expected<ServeRequest> ParseRequest(StringRef Line, bool& Shutdown) {
+  Expected<json::Value> VOrErr = json::parse(Line);
+  if (!VOrErr)
+    return VOrErr.takeError();
+  json::Object* O = VOrErr->getAsObject();
+  if (!O)
+    return MakeError("request is not an object");
+
+  ServeRequest Req;
+  if (const json::Value* ID = O->get("id"))
+    Req.ID = *ID;
+  if (O->getBoolean("shutdown").value_or(false)) {
+    Shutdown = true;
+    return Req;
+  }
+  if (auto Cwd = O->getString("cwd"))
+    Req.Cwd = Cwd->str();
+  json::Array* Args = O->getArray("args");
+  if (!Args)
+    return MakeError("request has no args");
+  for (const json::Value& Arg : *Args) {
+    auto S = Arg.getAsString();
+    if (!S)
+      return MakeError("arg is not a string");
+    Req.Args.push_back(S->str());
+  }
+  return Req;
+}
+
+/// Runs the request in `Line`, returning the response.
+static std::string HandleLine(StringRef Line, ServeHandler Handle,
+                              bool& Shutdown) {
+  auto Respond = [] (json::Value ID, int Status, StringRef Err = "") {
+    json::Object Out {{"id", std::move(ID)}, {"status", Status}};
+    if (!Err.empty())
+      Out["error"] = Err;
+    return formatv("{0}\n", json::Value(std::move(Out))).str();
+  };
+
+  Expected<ServeRequest> ReqOrErr = ParseRequest(Line, Shutdown);
+  if (!ReqOrErr)
+    return Respond(nullptr, 1, toString(ReqOrErr.takeError()));
+  if (Shutdown)
+    return Respond(std::move(ReqOrErr->ID), 0);
+
+  // Relative paths in the request are from the client's directory.
+  SmallString<128> OldCwd;
+  if (auto EC = sys::fs::current_path(OldCwd))
+    return Respond(std::move(ReqOrErr->ID), 1, EC.message());
+  if (!ReqOrErr->Cwd.empty()) {
+    if (auto EC = sys::fs::set_current_path(ReqOrErr->Cwd))
+      return Respond(std::move(ReqOrErr->ID), 1,
+                     "For '" + ReqOrErr->Cwd + "': " + EC.message());
+  }
+  const int Status = Handle(*ReqOrErr);
+  sys::fs::set_current_path(OldCwd);
+  outs().flush();
+  errs().flush();
+  return Respond(std::move(ReqOrErr->ID), Status);
+}
+
+int debase_tool::ServeStdin(ServeHandler Handle) {
+  bool Shutdown = false;
+  std::string Line;
+  while (!Shutdown && std::getline(std::cin, Line)) {
+    if (StringRef(Line).trim().empty())
+      continue;
+    outs() << HandleLine(Line, Handle, Shutdown);
+    outs().flush();
+  }
+  return 0;
+}
+
+int debase_tool::ServeSocket(StringRef SocketPath, ServeHandler Handle) {
+  Expected<ListeningSocket> LSOrErr = ListeningSocket::createUnix(SocketPath);
+  if (!LSOrErr) {
+    WithColor::error(errs())
+      << "Unable to listen on '" << SocketPath << "': "
+      << toString(LSOrErr.takeError()) << '\n';
+    return 1;
+  }
+  WithColor::remark(outs()) << "Serving on '" << SocketPath << "'.\n";
+  outs().flush();
+
+  bool Shutdown = false;
+  char Chunk[4096];
+  while (!Shutdown) {
+    auto StreamOrErr = LSOrErr->accept();
+    if (!StreamOrErr) {
+      WithColor::warning(errs())
+        << "Unable to accept connection: "
+        << toString(StreamOrErr.takeError()) << '\n';
+      continue;
+    }
+    raw_socket_stream& S = **StreamOrErr;
+    // Clients may send multiple requests before disconnecting.
+    std::string Buf;
+    while (!Shutdown) {
+      const size_t NL = Buf.find('\n');
+      if (NL == std::string::npos) {
+        const ssize_t N = S.read(Chunk, sizeof(Chunk));
+        if (N <= 0)
+          break;
+        Buf.append(Chunk, N);
+        continue;
+      }
+      StringRef Line = StringRef(Buf).take_front(NL).trim();
+      if (!Line.empty()) {
+        S << HandleLine(Line, Handle, Shutdown);
+        S.flush();
+      }
+      Buf.erase(0, NL + 1);
+    }
+  }
+  LSOrErr->shutdown();
+  return 0;
+}
@@ -0,0 +1,59 @@
+//===- driver/Server.hpp --------------------------------------------------===//
+//
+// Copyright (C) 2026 Ninefold
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file declares the request loop used by `--serve`. Requests are one
+/// JSON object per line:
+///
+///   {"id": 1, "cwd": "/path", "args": ["lib.a", "-o", "out", ...]}
+///   {"shutdown": true}
+///
+/// and each gets a single line response, `{"id": 1, "status": 0}`.
+///
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include "llvm/Support/JSON.h"
+#include "LLVM.hpp"
+#include <string>
+#include <vector>
+
+namespace debase_tool {
+
+/// A single job for the server, with the arguments the driver would take.
+struct ServeRequest {
+  /// Echoed back in the response, so clients can find it.
+  llvm::json::Value ID = nullptr;
+  /// The directory to run in, or empty for the server's.
+  std::string Cwd;
+  /// The arguments, excluding the program name.
+  std::vector<std::string> Args;
+};
+
+/// Runs a request, returning the exit code.
+using ServeHandler = llvm::function_ref<int(const ServeRequest&)>;
+
+/// Serves requests from stdin until it's closed. Responses are written to
+/// stdout, so clients must skip any other output.
+int ServeStdin(ServeHandler Handle);
+/// Serves requests on the local socket `SocketPath`, one connection at a time.
+int ServeSocket(StringRef SocketPath, ServeHandler Handle);
+
+} // namespace debase_tool
@@ -21,6 +21,7 @@
 #include "LLVM.hpp"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Error.h"
+#include <atomic>
 
 namespace debase_tool {
 
@@ -32,6 +33,9 @@ extern bool Strict;
 extern bool Permissive;
 /// Enabled if and only if `--verbose`.
 extern bool Verbose;
+/// Set while jobs run or `--serve` handles a request. Errors which would exit
+/// mark it as failed instead, so threads are joined and the server survives.
+extern std::atomic<bool>* RequestFailed;
 
 /// Creates a new string error by forwarding the arguments to
 /// `llvm::createStringError`.
@@ -49,8 +53,13 @@ inline llvm::Error MakeError(const Twine& Msg) {
 }
 
 inline void exitP(int ErrorCode = 1) {
-  if (LLVM_UNLIKELY(!Permissive))
-    std::exit(ErrorCode);
+  if (LLVM_LIKELY(Permissive))
+    return;
+  if (RequestFailed) {
+    *RequestFailed = true;
+    return;
+  }
+  std::exit(ErrorCode);
 }
 
 } // namespace debase_tool
@@ -25,35 +25,59 @@
 
 #include "NameClassifier.hpp"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/StringSaver.h"
+#include "llvm/Support/xxhash.h"
+#include <cstdint>
 
 namespace debase_tool {
 
-/// The useful features found in a function symbol.
+/// The length and hash of a name component. Names with different keys can
+/// never be equal, so most mismatches are a single integer compare.
+using NameKey = uint64_t;
+
+/// Computes the `NameKey` of `Name`.
+inline NameKey GetNameKey(StringRef Name) {
+  const auto Hash = llvm::xxh3_64bits(llvm::arrayRefFromStringRef(Name));
+  return (uint64_t(Name.size()) << 32) | uint32_t(Hash);
+}
+
+/// The useful features found in a function symbol. Names reference either the
+/// symbol itself or `Arena`, so they're only valid until the next `clear()`.
 struct SymbolFeatures {
   //std::string BaseName;
-  SmallVector<std::string> NestedNames;
+  SmallVector<StringRef> NestedNames;
   SymbolKind SymKind = SymbolKind::Invalid;
   int Variant = -1; // For itanium compat
   bool HasBaseName = false;
+  /// Storage for names which don't outlive the demangler, reused between symbols.
+  llvm::BumpPtrAllocator Arena;
 
 public:
-  template <typename ArgT> void setBase(ArgT&& arg) {
+  void setBase(StringRef Name) {
     if (LLVM_UNLIKELY(HasBaseName))
       NestedNames.pop_back();
-    NestedNames.emplace_back(std::forward<ArgT>(arg));
+    NestedNames.push_back(Name);
     HasBaseName = true;
   }
-  template <typename ArgT> void addNested(ArgT&& arg) {
+  void addNested(StringRef Name) {
     if (LLVM_LIKELY(!HasBaseName))
-      NestedNames.emplace_back(std::forward<ArgT>(arg));
+      NestedNames.push_back(Name);
+  }
+  /// Copies `Name` into the arena.
+  StringRef save(StringRef Name) {
+    return llvm::StringSaver(Arena).save(Name);
   }
 
   StringRef baseName() const {
     assert(HasBaseName && !NestedNames.empty());
-    return StringRef(NestedNames.back());
+    return NestedNames.back();
   }
-  ArrayRef<std::string> nestedNames() const {
+  ArrayRef<StringRef> nestedNames() const {
     assert(!NestedNames.empty());
     return ArrayRef(NestedNames).drop_back();
   }
@@ -68,10 +92,90 @@ public:
   void clear() {
     //BaseName.clear();
     NestedNames.clear();
+    Arena.Reset();
     SymKind = SymbolKind::Invalid;
     Variant = -1;
     HasBaseName = false;
   }
 };
 
+/// The features of a batch of symbols, stored as a structure of arrays.
+/// Symbol `I` has the names `[Offsets[I], Offsets[I + 1])`, with the last being
+/// the base name. Only constructors and destructors store their names.
+/// Components are interned, so names stay valid until the next `clear()`.
+struct SymbolFeaturesBatch {
+  SmallVector<SymbolKind> Kinds;
+  SmallVector<int8_t> Variants;
+  SmallVector<unsigned> Offsets {0};
+  /// Per-symbol names, referencing the interned storage.
+  SmallVector<StringRef> Names;
+  /// Per-symbol component IDs, parallel to `Names`.
+  SmallVector<unsigned> NameIDs;
+  /// Per-symbol component keys, parallel to `Names`.
+  SmallVector<NameKey> NameKeys;
+  /// Maps unique components to their IDs.
+  llvm::StringMap<unsigned> ComponentIDs;
+  /// The keys of each unique component, indexed by ID.
+  SmallVector<NameKey> ComponentKeys;
+
+public:
+  unsigned size() const { return Kinds.size(); }
+  bool empty() const { return Kinds.empty(); }
+
+  SymbolKind kind(unsigned I) const { return Kinds[I]; }
+  int variant(unsigned I) const { return Variants[I]; }
+  bool isCtor(unsigned I) const { return Kinds[I] == SymbolKind::Constructor; }
+  bool isDtor(unsigned I) const { return Kinds[I] == SymbolKind::Destructor; }
+  bool isCtorDtor(unsigned I) const { return isCtor(I) || isDtor(I); }
+
+  /// Returns all names of symbol `I`, including the base name.
+  ArrayRef<StringRef> names(unsigned I) const {
+    return ArrayRef(Names).slice(Offsets[I], Offsets[I + 1] - Offsets[I]);
+  }
+  /// Returns the component IDs of symbol `I`, including the base name.
+  ArrayRef<unsigned> nameIDs(unsigned I) const {
+    return ArrayRef(NameIDs).slice(Offsets[I], Offsets[I + 1] - Offsets[I]);
+  }
+  /// Returns the component keys of symbol `I`, including the base name.
+  ArrayRef<NameKey> nameKeys(unsigned I) const {
+    return ArrayRef(NameKeys).slice(Offsets[I], Offsets[I + 1] - Offsets[I]);
+  }
+  StringRef baseName(unsigned I) const {
+    assert(Offsets[I] != Offsets[I + 1]);
+    return Names[Offsets[I + 1] - 1];
+  }
+  /// Returns the number of unique components in the batch.
+  unsigned componentCount() const { return ComponentIDs.size(); }
+
+  /// Appends a set of features, interning its names.
+  void push_back(SymbolKind K, const SymbolFeatures& F) {
+    Kinds.push_back(K);
+    Variants.push_back(static_cast<int8_t>(F.Variant));
+    if (LLVM_LIKELY(F.isCtorDtor() && F.HasBaseName)) {
+      for (StringRef Name : F.NestedNames) {
+        auto [It, DidEmplace] =
+          ComponentIDs.try_emplace(Name, ComponentIDs.size());
+        // Keys are only computed once per unique component.
+        if (DidEmplace)
+          ComponentKeys.push_back(GetNameKey(Name));
+        Names.push_back(It->first());
+        NameIDs.push_back(It->second);
+        NameKeys.push_back(ComponentKeys[It->second]);
+      }
+    }
+    Offsets.push_back(Names.size());
+  }
+
+  void clear() {
+    Kinds.clear();
+    Variants.clear();
+    Offsets.assign(1, 0);
+    Names.clear();
+    NameIDs.clear();
+    NameKeys.clear();
+    ComponentIDs.clear();
+    ComponentKeys.clear();
+  }
+};
+
 } // namespace debase_tool
@@ -23,6 +23,7 @@
 
 #include "SymbolMatcher.hpp"
 #include "Shared.hpp"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/ScopeExit.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Option/Option.h"
@@ -33,6 +34,7 @@
 #include "llvm/Support/Path.h"
 #include "llvm/Support/WithColor.h"
 #include "Character.hpp"
+#include "CompiledConfig.hpp"
 #include "FilePropertyCache.hpp"
 #include "PatternLex.hpp"
 #include "SymbolFeatures.hpp"
@@ -92,16 +94,37 @@ InputPatterns("patterns",
   cl::ZeroOrMore
 );
 
-SymbolMatcher::SymbolMatcher(bool Permissive)
+SymbolMatcher::SymbolMatcher(bool Permissive, bool IsolateExternal)
     : PatternMappings(BP), Permissive(Permissive) {
-  if (auto* CL = SMCLHandler.get()) {
+  auto* CL = SMCLHandler.get();
+  if (!CL)
+    return;
+  if (!IsolateExternal) {
     for (auto&& [Name, P] : CL->PatternMappings)
       this->addExternalPattern(Name, P);
     // TODO: Find a better method if needed
     this->ExtReplacements = &CL->Replacements;
+    return;
+  }
+  // Compile our own copies, so replacements stay local.
+  for (auto&& [Name, P] : CL->PatternMappings) {
+    if (LLVM_UNLIKELY(P == nullptr))
+      // Already warned about in `CLOptHandler::push_back`.
+      continue;
+    Expected<Pattern*> POrErr = this->compilePattern(Name);
+    if (!POrErr) {
+      consumeError(POrErr.takeError());
+      continue;
+    }
+    CtorPatterns.insert(*POrErr);
+    DtorPatterns.insert(*POrErr);
   }
 }
 
+SymbolMatcher::SymbolMatcher(bool Permissive)
+    : SymbolMatcher(Permissive, /*IsolateExternal=*/false) {
+}
+
 SymbolMatcher::SymbolMatcher()
     : SymbolMatcher(debase_tool::Permissive) {
 }
@@ -118,7 +141,10 @@ SymbolMatcher::~SymbolMatcher() {
 }
 
 Error SymbolMatcher::setFilename(StringRef Filename) {
-  CurrentFilename = intern(Filename);
+  // Reuse the same buffer, every replacer is updated below. Formatted
+  // replacers own their values, and are skipped if they didn't change.
+  CurrentFilenameStorage = Filename;
+  CurrentFilename = CurrentFilenameStorage.str();
   FilePropertyCache FPC(*CurrentFilename);
   int ErrorCount = 0;
   for (Replacer* R : Replacements) {
@@ -142,24 +168,183 @@ Error SymbolMatcher::setFilename(StringRef Filename) {
   return Error::success();
 }
 
-static bool MatchAgainst(const SymbolMatcher::PatternStorageTy& Patterns,
-                         ArrayRef<std::string> Syms) {
-  for (Pattern* P : Patterns)
-    if (P->matchSymbol(Syms))
+/// Returns the relative cost of matching `P` on its own.
+static unsigned GetMatchCost(const Pattern* P) {
+  switch (P->kind()) {
+  case PatternKind::Simple:
+  case PatternKind::LeadingSimple:
+  case PatternKind::Forwarding:
+  case PatternKind::Solo:
+    return 1;
+  case PatternKind::SingleSequence:
+  case PatternKind::LeadingGlob:
+  case PatternKind::ButterflyGlob:
+    return 2;
+  case PatternKind::AnySequence:
+    return 4;
+  case PatternKind::Regex:
+  default:
+    return 8;
+  }
+}
+
+/// Returns if `P` only matches exactly `requiredCount()` names.
+static bool HasExactCount(const Pattern* P) {
+  switch (P->kind()) {
+  case PatternKind::Simple:
+  case PatternKind::SingleSequence:
+  case PatternKind::Forwarding:
+  case PatternKind::Solo:
+  case PatternKind::Regex:
+    return true;
+  default:
+    return false;
+  }
+}
+
+const SymbolMatcher::CompiledPatterns& SymbolMatcher::GetCompiled(
+    const PatternStorageTy& Patterns, CompiledPatterns& Out) {
+  if (LLVM_LIKELY(Out.SourceSize == Patterns.size()))
+    return Out;
+  Out = CompiledPatterns();
+  for (Pattern* P : Patterns) {
+    if (Out.Automaton.add(P))
+      continue;
+    FallbackPattern F {P, 0, GetMatchCost(P), P->requiredCount()};
+    if (!HasExactCount(P)) {
+      Out.AtLeast.push_back(F);
+      continue;
+    }
+    if (Out.Exact.size() <= F.MinCount)
+      Out.Exact.resize(F.MinCount + 1);
+    Out.Exact[F.MinCount].push_back(F);
+  }
+  for (FallbackList& L : Out.Exact)
+    SortFallbacks(L);
+  SortFallbacks(Out.AtLeast);
+  Out.SourceSize = Patterns.size();
+  return Out;
+}
+
+void SymbolMatcher::SortFallbacks(FallbackList& L) {
+  // Patterns without hits are ordered by cost alone.
+  llvm::stable_sort(L, [] (const FallbackPattern& A, const FallbackPattern& B) {
+    return uint64_t(A.Hits + 1) * B.Cost > uint64_t(B.Hits + 1) * A.Cost;
+  });
+}
+
+void SymbolMatcher::ReorderFallbacks(CompiledPatterns& Compiled) {
+  auto Reorder = [] (FallbackList& L) {
+    SortFallbacks(L);
+    // Decay old hits, so the order follows what's currently hot.
+    for (FallbackPattern& F : L)
+      F.Hits /= 2;
+  };
+  for (FallbackList& L : Compiled.Exact)
+    Reorder(L);
+  Reorder(Compiled.AtLeast);
+  Compiled.UntilReorder = kReorderInterval;
+}
+
+void SymbolMatcher::compilePatterns() const {
+  GetCompiled(CtorPatterns, CompiledCtors);
+  GetCompiled(DtorPatterns, CompiledDtors);
+}
+
+std::string SymbolMatcher::getFingerprint() const {
+  SmallVector<StringRef, 16> Names;
+  for (const StringMapEntry<Pattern*>& KV : PatternMappings) {
+    if (KV.second)
+      Names.push_back(KV.first());
+  }
+  llvm::sort(Names);
+  std::string Out;
+  raw_string_ostream OS(Out);
+  for (StringRef Name : Names) {
+    Pattern* P = PatternMappings.lookup(Name);
+    OS << (CtorPatterns.contains(P) ? 'C' : '-')
+       << (DtorPatterns.contains(P) ? 'D' : '-')
+       << Name << '\n';
+  }
+  return Out;
+}
+
+bool SymbolMatcher::MatchCompiled(const PatternStorageTy& Patterns,
+                                  CompiledPatterns& Compiled,
+                                  ArrayRef<StringRef> Syms,
+                                  ArrayRef<NameKey> Keys) {
+  GetCompiled(Patterns, Compiled);
+  CompiledPatterns& C = Compiled;
+  if (C.Automaton.match(Syms, Keys))
+    return true;
+  if (LLVM_UNLIKELY(--C.UntilReorder == 0))
+    ReorderFallbacks(C);
+  // Only check the patterns which can match this many names.
+  if (Syms.size() < C.Exact.size()) {
+    for (FallbackPattern& F : C.Exact[Syms.size()]) {
+      if (F.P->matchSymbol(Syms)) {
+        ++F.Hits;
+        return true;
+      }
+    }
+  }
+  for (FallbackPattern& F : C.AtLeast) {
+    if (Syms.size() >= F.MinCount && F.P->matchSymbol(Syms)) {
+      ++F.Hits;
       return true;
+    }
+  }
   return false;
 }
 
+bool SymbolMatcher::matchNames(bool IsCtor, ArrayRef<StringRef> Names,
+                               ArrayRef<NameKey> Keys) const {
+  if (BaseTrie && BaseTrie->match(Names, Keys))
+    return true;
+  // Now check specifics.
+  if (IsCtor)
+    return MatchCompiled(CtorPatterns, CompiledCtors, Names, Keys);
+  else /*IsDtor*/
+    return MatchCompiled(DtorPatterns, CompiledDtors, Names, Keys);
+}
+
 bool SymbolMatcher::match(const SymbolFeatures& Features) const {
   if (!Features.isCtorDtor())
     return false;
-  if (BaseTrie && BaseTrie->contains(Features.baseName()))
-    return true;
-  // Now check specifics.
-  if (Features.isCtor())
-    return MatchAgainst(CtorPatterns, Features.NestedNames);
-  else /*Features.isDtor()*/
-    return MatchAgainst(DtorPatterns, Features.NestedNames); 
+  SmallVector<NameKey, 8> Keys;
+  Keys.reserve(Features.NestedNames.size());
+  for (StringRef Name : Features.NestedNames)
+    Keys.push_back(GetNameKey(Name));
+  return matchNames(Features.isCtor(), Features.NestedNames, Keys);
+}
+
+bool SymbolMatcher::match(const SymbolFeaturesBatch& Batch, unsigned I) const {
+  if (!Batch.isCtorDtor(I))
+    return false;
+  return matchNames(Batch.isCtor(I), Batch.names(I), Batch.nameKeys(I));
+}
+
+void SymbolMatcher::matchAll(const SymbolFeaturesBatch& Batch,
+                             SmallVectorImpl<unsigned>& Matched) const {
+  for (unsigned I = 0, E = Batch.size(); I != E; ++I)
+    if (match(Batch, I))
+      Matched.push_back(I);
+}
+
+void SymbolMatcher::findMatchingPatterns(
+    const SymbolFeatures& Features, SmallVectorImpl<StringRef>& Out) const {
+  if (!Features.isCtorDtor())
+    return;
+  ArrayRef<StringRef> Names = Features.NestedNames;
+  if (BaseTrie && BaseTrie->match(Names))
+    Out.push_back("<basetrie>");
+  const PatternStorageTy& Patterns =
+    Features.isCtor() ? CtorPatterns : DtorPatterns;
+  for (const StringMapEntry<Pattern*>& KV : PatternMappings) {
+    Pattern* P = KV.second;
+    if (P && Patterns.contains(P) && P->matchSymbol(Names))
+      Out.push_back(KV.first());
+  }
 }
 
 StringRef SymbolMatcher::intern(StringRef S) {
@@ -199,6 +384,10 @@ Expected<Pattern*> SymbolMatcher::compilePattern(
     return It->second;
   // Use our newly generated value
   Pat = It->first();
+  // The tokens are needed to write the config again.
+  SmallVector<Pattern::Token> LocalToks;
+  if (Recorded && !ToksBuf)
+    ToksBuf = &LocalToks;
   Expected<Pattern*> CompiledOrErr = [=, this] {
     if (ToksBuf)
       return this->compilePatternImpl(Pat, *ToksBuf);
@@ -207,6 +396,8 @@ Expected<Pattern*> SymbolMatcher::compilePattern(
   }();
   if (!CompiledOrErr)
     return CompiledOrErr.takeError();
+  if (Recorded)
+    Recorded->Patterns.push_back({Pat, {ToksBuf->begin(), ToksBuf->end()}});
   return (It->second = *CompiledOrErr);
 }
 
@@ -424,6 +615,7 @@ public:
   JSONLoaderHandler(JSONLoaderHandler&&) = default;
   /// Creates a new `JSONLoaderHandler` from `Filename`, otherwise returns error.
   static Expected<JSONLoaderHandler> New(StringRef Filename,
+                                         StringRef FileContents,
                                          SymbolMatcher* thiz,
                                          SmallVectorImpl<std::string>* OutFiles);
 private:
@@ -469,14 +661,10 @@ public:
 };
 
 Expected<JSONLoaderHandler> JSONLoaderHandler::New(StringRef Filename,
+                                                   StringRef FileContents,
                                                    SymbolMatcher* thiz,
                                                    SmallVectorImpl<std::string>* OutFiles) {
-  ErrorOr<std::unique_ptr<MemoryBuffer>> FileOrErr =
-      MemoryBuffer::getFile(Filename);
-  if (std::error_code EC = FileOrErr.getError())
-    return llvm::createFileError(Filename, EC);
   // Parse JSON
-  StringRef FileContents = (*FileOrErr)->getBuffer();
   Expected<json::Value> JSON = json::parse(FileContents);
   if (!JSON)
     return llvm::createFileError(Filename, JSON.takeError());
@@ -655,6 +843,7 @@ Error JSONLoaderHandler::loadBasetrie(json::Array& patterns) {
     return P->BaseTrie.emplace();
   } ();
 
+  SmallVector<StringRef, 4> Names;
   for (auto& _pattern : patterns) {
     auto pattern = _pattern.getAsString();
     if (LLVM_UNLIKELY(!pattern)) {
@@ -662,13 +851,28 @@ Error JSONLoaderHandler::loadBasetrie(json::Array& patterns) {
         continue;
       return report("basetrie is not a string");
     }
-    if (!Character::isIdentifier(*pattern)) {
+    // `ns::Class` matches the full path, `Class` matches any base name.
+    StringRef Path = *pattern;
+    const bool Qualified = Path.contains("::");
+    Path.consume_front("::");
+    Names.clear();
+    Path.split(Names, "::");
+    if (!llvm::all_of(Names, [](StringRef Name) {
+          return !Name.empty() && Character::isIdentifier(Name);
+        })) {
       if (P->Permissive)
         continue;
       return report("basetrie contains non-identifier: " + Twine(*pattern));
     }
     // Now actually load the pattern.
-    BaseTrie.insert(*pattern);
+    for (StringRef& Name : Names)
+      Name = P->intern(Name);
+    if (P->Recorded)
+      P->Recorded->Basetrie.push_back({Qualified, {Names.begin(), Names.end()}});
+    if (Qualified)
+      BaseTrie.addExact(Names);
+    else
+      BaseTrie.addSuffix(Names);
   }
 
   return Error::success();
@@ -701,13 +905,26 @@ Error SymbolMatcher::loadSymbolsFromJSONFile(
   if (auto EC = sys::fs::make_absolute(ConfigFileReal))
     return llvm::createFileError(ConfigFile, EC);
   ConfigFileReal = sys::path::convert_to_slash(ConfigFileReal.str());
-  // Load the config
-  Expected<JSONLoaderHandler> JSON =
-      JSONLoaderHandler::New(ConfigFileReal.str(), this, OutFiles);
-  if (!JSON)
-    return JSON.takeError();
-  if (auto E = JSON->load())
-    return E;
+  ErrorOr<std::unique_ptr<MemoryBuffer>> FileOrErr =
+      MemoryBuffer::getFile(ConfigFileReal, /*IsText=*/false,
+                            /*RequiresNullTerminator=*/false);
+  if (std::error_code EC = FileOrErr.getError())
+    return llvm::createFileError(ConfigFile, EC);
+  if (compiled_config::IsCompiledConfig((*FileOrErr)->getBuffer())) {
+    // Compiled with `--compile-config`, the patterns point into the mapping.
+    if (auto E = loadCompiledConfig(std::move(*FileOrErr), OutFiles))
+      return E;
+  } else {
+    // Load the config
+    Expected<JSONLoaderHandler> JSON = JSONLoaderHandler::New(
+        ConfigFileReal.str(), (*FileOrErr)->getBuffer(), this, OutFiles);
+    if (!JSON)
+      return JSON.takeError();
+    if (auto E = JSON->load())
+      return E;
+  }
   setConfigFilename(ConfigFileReal.str());
+  // Build the automata now, rather than on the first match.
+  compilePatterns();
   return Error::success();
 }
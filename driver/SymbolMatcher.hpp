@@ -24,17 +24,21 @@
 #pragma once
 
 #include "llvm/ADT/StringMap.h"
-#include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/StringSaver.h"
 #include "LLVM.hpp"
 #include "Pattern.hpp"
+#include "PatternAutomaton.hpp"
+#include <memory>
 #include <optional>
+#include <string>
 #include <utility>
 
 namespace llvm {
+class MemoryBuffer;
 class Module;
 } // namespace llvm
 
@@ -52,15 +56,47 @@ public:
   /// The type used to store patterns.
   using PatternStorageTy = llvm::SmallPtrSet<Pattern*, 8>;
   /// Type type used to store the trie.
-  using SymTrieTy = llvm::StringSet<>;
+  using SymTrieTy = PatternAutomaton;
   
 private:
   /// Patterns used for matching constructors.
   PatternStorageTy CtorPatterns;
   /// Patterns used for matching destructors.
   PatternStorageTy DtorPatterns;
-  /// "trie" for faster name lookups for simple names.
+  /// Trie for faster lookups of literal names.
   std::optional<SymTrieTy> BaseTrie;
+
+  /// A pattern the automaton can't handle, which is checked on its own.
+  struct FallbackPattern {
+    Pattern* P = nullptr;
+    /// Matches since the last reorder.
+    unsigned Hits = 0;
+    /// The relative cost of checking `P`, from its kind.
+    unsigned Cost = 1;
+    /// The required count, cached to avoid the virtual call.
+    unsigned MinCount = 0;
+  };
+  using FallbackList = SmallVector<FallbackPattern, 2>;
+  /// How many lookups between reordering fallbacks by their hits.
+  static constexpr unsigned kReorderInterval = 1024;
+
+  /// Patterns compiled into a single automaton, with the rest as fallbacks.
+  /// Fallbacks are bucketed by count, and ordered by cost and hits.
+  struct CompiledPatterns {
+    PatternAutomaton Automaton;
+    /// Fallbacks matching exactly `N` names, indexed by `N`.
+    SmallVector<FallbackList, 4> Exact;
+    /// Fallbacks matching at least `MinCount` names.
+    FallbackList AtLeast;
+    /// Lookups until the fallbacks are next reordered.
+    unsigned UntilReorder = kReorderInterval;
+    /// The size of the set this was compiled from, patterns are never removed.
+    unsigned SourceSize = 0;
+  };
+  /// Lazily compiled `CtorPatterns`.
+  mutable CompiledPatterns CompiledCtors;
+  /// Lazily compiled `DtorPatterns`.
+  mutable CompiledPatterns CompiledDtors;
   /// Contains the Patterns which need to be destroyed.
   llvm::SmallPtrSet<Pattern*, 4> ToDestroy;
 
@@ -75,6 +111,14 @@ private:
   std::optional<StringRef> ConfigFilename;
   /// Filename of the current module.
   std::optional<StringRef> CurrentFilename;
+  /// Storage for `CurrentFilename`, reused between modules.
+  SmallString<128> CurrentFilenameStorage;
+
+  /// What was loaded from the config, kept for `writeCompiledConfig`.
+  struct ConfigRecord;
+  std::unique_ptr<ConfigRecord> Recorded;
+  /// A mapped compiled config, which the loaded patterns point into.
+  std::unique_ptr<llvm::MemoryBuffer> ConfigImage;
 
   /// If errors can be continued.
   bool Permissive = false;
@@ -87,6 +131,10 @@ public:
 
   SymbolMatcher();
   SymbolMatcher(bool Permissive);
+  /// If `IsolateExternal` is set, patterns from `--patterns` are recompiled
+  /// into this matcher instead of being shared. Required when multiple
+  /// matchers are used at once, as `setFilename` modifies patterns in place.
+  SymbolMatcher(bool Permissive, bool IsolateExternal);
   ~SymbolMatcher();
 
   /// Loads symbol patterns and filenames from a JSON config file.
@@ -108,16 +156,66 @@ public:
   bool loadedConfig() const {
     return ConfigFilename.has_value();
   }
+  /// Returns if match results can change with `setFilename`.
+  bool dependsOnFilename() const {
+    return !Replacements.empty()
+        || (ExtReplacements && !ExtReplacements->empty());
+  }
+
+  /// Keeps the lexed config around, so it can be written with
+  /// `writeCompiledConfig`. Must be called before loading.
+  void recordConfig();
+  /// Writes the loaded config as an image which `loadConfig` can map
+  /// directly, skipping parsing and lexing.
+  llvm::Error writeCompiledConfig(raw_ostream& OS,
+                                  ArrayRef<std::string> Files) const;
 
 private:
   /// Sets the config filename.
   void setConfigFilename(StringRef Filename);
+  /// Loads a config written by `writeCompiledConfig`.
+  llvm::Error loadCompiledConfig(std::unique_ptr<llvm::MemoryBuffer> Image,
+                                 SmallVectorImpl<std::string>* OutFiles);
 
 public:
   /// TODO: Remove?
   llvm::Error setFilename(StringRef Filename);
   /// Matches symbol against its respective patterns
   bool match(const SymbolFeatures& Features) const;
+  /// Matches symbol `I` of a batch against its respective patterns.
+  bool match(const SymbolFeaturesBatch& Batch, unsigned I) const;
+  /// Matches an entire batch, appending the indices of matched symbols.
+  void matchAll(const SymbolFeaturesBatch& Batch,
+                SmallVectorImpl<unsigned>& Matched) const;
+  /// Appends the source of every pattern accepting `Features`. Much slower
+  /// than `match`, as each pattern is checked on its own.
+  void findMatchingPatterns(const SymbolFeatures& Features,
+                            SmallVectorImpl<StringRef>& Out) const;
+  /// Compiles the current patterns into automata. Done lazily when matching,
+  /// but can be called ahead of time after loading.
+  void compilePatterns() const;
+  /// Returns a stable description of every pattern, used to key caches.
+  std::string getFingerprint() const;
+
+private:
+  /// Returns the compiled form of `Patterns`, rebuilding if it changed.
+  static const CompiledPatterns& GetCompiled(const PatternStorageTy& Patterns,
+                                             CompiledPatterns& Out);
+  /// Orders fallbacks by their chance to match over their cost, so the cheap
+  /// and hot ones are checked first.
+  static void SortFallbacks(FallbackList& L);
+  /// Reorders the fallbacks of `Compiled` by their hits, then decays them.
+  static void ReorderFallbacks(CompiledPatterns& Compiled);
+  /// Matches against the compiled form of `Patterns`.
+  static bool MatchCompiled(const PatternStorageTy& Patterns,
+                            CompiledPatterns& Compiled,
+                            ArrayRef<StringRef> Syms,
+                            ArrayRef<NameKey> Keys);
+  /// Matches a ctor/dtor's names against the trie and patterns.
+  bool matchNames(bool IsCtor, ArrayRef<StringRef> Names,
+                  ArrayRef<NameKey> Keys) const;
+
+public:
 
   /// Creates a new `Pattern` object if uncached, otherwise returns cached.
   Expected<Pattern*> compilePattern(
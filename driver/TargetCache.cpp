@@ -0,0 +1,66 @@
+//===- driver/TargetCache.cpp ---------------------------------------------===//
+//
+// Copyright (C) 2026 Ninefold
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the TargetCache class.
+///
+//===----------------------------------------------------------------------===//
+
+#include "TargetCache.hpp"
+#include "TargetInit.hpp"
+#include "llvm/CodeGen/CommandFlags.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/TargetParser/Triple.h"
+
+using namespace debase_tool;
+using namespace llvm;
+
+CachedTargetInfo::CachedTargetInfo(const Triple& TT,
+                                   std::unique_ptr<TargetMachine> InTM)
+ : TM(std::move(InTM)), TLII(TT) {
+  if (TM)
+    DataLayoutStr = TM->createDataLayout().getStringRepresentation();
+  //// Add TLII Pass.
+  //Passes.add(new TargetLibraryInfoWrapperPass(TLII));
+  //// Add internal analysis passes from the target machine.
+  //Passes.add(createTargetTransformInfoWrapperPass(TM ? TM->getTargetIRAnalysis()
+  //                                                   : TargetIRAnalysis()));
+  //if (TM) {
+  //  // FIXME: We should dyn_cast this when supported.
+  //  auto& LTM = static_cast<LLVMTargetMachine&>(*TM);
+  //  Passes.add(LTM.createPassConfig(Passes));
+  //}
+}
+
+Expected<CachedTargetInfo*> TargetCache::get(StringRef TT) {
+  auto It = Cache.find(TT);
+  if (It != Cache.end())
+    return It->second.get();
+  std::string Error;
+  if (!InitializeTargetFor(TT, Error))
+    return createStringError(inconvertibleErrorCode(), Error);
+  Expected<std::unique_ptr<TargetMachine>> TMOrErr =
+    codegen::createTargetMachineForTriple(TT, OptLevel);
+  if (!TMOrErr)
+    return TMOrErr.takeError();
+  auto Info = std::make_unique<CachedTargetInfo>(
+    Triple(TT), std::move(*TMOrErr));
+  auto* Out = Info.get();
+  Cache[TT] = std::move(Info);
+  return Out;
+}
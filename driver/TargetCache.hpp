@@ -0,0 +1,65 @@
+//===- driver/TargetCache.hpp ---------------------------------------------===//
+//
+// Copyright (C) 2026 Ninefold
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file defines the TargetCache class, which keeps the expensive target
+/// state for every triple seen.
+///
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Support/CodeGen.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/Utils/Debugify.h"
+#include "LLVM.hpp"
+#include <memory>
+#include <string>
+
+namespace debase_tool {
+
+/// Info that stays the same with every triple.
+struct CachedTargetInfo {
+  std::unique_ptr<llvm::TargetMachine> TM = nullptr;
+  llvm::TargetLibraryInfoImpl TLII;
+  /// The data layout of `TM`.
+  std::string DataLayoutStr;
+  llvm::DebugifyCustomPassManager Passes;
+public:
+  CachedTargetInfo(const llvm::Triple& TT,
+                   std::unique_ptr<llvm::TargetMachine> InTM);
+};
+
+/// Creates a `CachedTargetInfo` the first time a triple is used, and reuses it
+/// for every module after. Not thread safe, so each worker keeps its own.
+class TargetCache {
+  llvm::StringMap<std::unique_ptr<CachedTargetInfo>> Cache;
+  llvm::CodeGenOptLevel OptLevel;
+public:
+  explicit TargetCache(llvm::CodeGenOptLevel OptLevel) : OptLevel(OptLevel) {}
+
+  /// Returns the info for `TT`, creating it if uncached.
+  llvm::Expected<CachedTargetInfo*> get(StringRef TT);
+  /// Returns the amount of triples cached.
+  unsigned size() const { return Cache.size(); }
+};
+
+} // namespace debase_tool
@@ -0,0 +1,146 @@
+//===- driver/TargetInit.cpp ----------------------------------------------===//
+//
+// Copyright (C) 2026 Ninefold
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// Initializes the configured LLVM targets on demand, only for the triples
+/// which are actually used.
+///
+//===----------------------------------------------------------------------===//
+
+#include "TargetInit.hpp"
+#include "LLVMTargets.hpp"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/PassRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include <iterator>
+#include <mutex>
+
+using namespace debase_tool;
+using namespace llvm;
+
+namespace {
+
+/// The initializers of a single configured target.
+struct TargetComponent {
+  void (*InitInfo)();
+  void (*InitTarget)();
+  void (*InitMC)();
+  void (*InitAsmPrinter)();
+  void (*InitAsmParser)();
+};
+
+/// Tracks what has been initialized for a component.
+struct ComponentState {
+  /// The MC layer and asm parser, needed for symbol tables.
+  std::once_flag MCOnce;
+  /// The target and asm printer, needed for codegen.
+  std::once_flag CodeGenOnce;
+};
+
+} // namespace `anonymous`
+
+// Disassemblers are never needed.
+static constexpr TargetComponent Components[] = {
+#define LLVM_TARGET(TargetName) {                                             \
+    &LLVMInitialize##TargetName##TargetInfo,                                  \
+    &LLVMInitialize##TargetName##Target,                                      \
+    &LLVMInitialize##TargetName##TargetMC,                                    \
+    &LLVMInitialize##TargetName##AsmPrinter,                                  \
+    &LLVMInitialize##TargetName##AsmParser },
+  INITIALIZE_TARGETS(LLVM_TARGET)
+#undef LLVM_TARGET
+};
+static constexpr unsigned NumComponents = std::size(Components);
+static ComponentState States[NumComponents];
+/// The component each registered target came from, read only after startup.
+static DenseMap<const Target*, unsigned> Owners;
+
+void debase_tool::InitializeTargetInfos() {
+  if (!Owners.empty())
+    return;
+  for (unsigned I = 0; I != NumComponents; ++I) {
+    Components[I].InitInfo();
+    // Anything new was registered by this component.
+    for (const Target& T : TargetRegistry::targets())
+      Owners.try_emplace(&T, I);
+  }
+}
+
+/// Finds the component which registered the target for `TT`.
+static const Target* LookupTarget(StringRef TT, std::string& Error,
+                                  unsigned& Component) {
+  const Target* T = TargetRegistry::lookupTarget(TT, Error);
+  if (!T)
+    return nullptr;
+  auto It = Owners.find(T);
+  Component = (It != Owners.end()) ? It->second : NumComponents;
+  return T;
+}
+
+static void InitializeMCFor(unsigned I) {
+  // Registered elsewhere.
+  if (I == NumComponents)
+    return;
+  std::call_once(States[I].MCOnce, [I] {
+    Components[I].InitMC();
+    Components[I].InitAsmParser();
+  });
+}
+
+/// Passes are only looked up by name when codegen options are used.
+static void InitializePassRegistry() {
+  static std::once_flag PassesOnce;
+  std::call_once(PassesOnce, [] {
+    PassRegistry& Registry = *PassRegistry::getPassRegistry();
+    initializeCore(Registry);
+    initializeCodeGen(Registry);
+    initializeScalarOpts(Registry);
+    initializeAnalysis(Registry);
+    initializeTransformUtils(Registry);
+    initializeInstCombine(Registry);
+    initializeTarget(Registry);
+  });
+}
+
+const Target* debase_tool::InitializeTargetFor(StringRef TT,
+                                               std::string& Error) {
+  unsigned I = NumComponents;
+  const Target* T = LookupTarget(TT, Error, I);
+  if (!T)
+    return nullptr;
+  InitializePassRegistry();
+  InitializeMCFor(I);
+  if (I != NumComponents) {
+    // The asm parser is needed here too, to emit inline assembly.
+    std::call_once(States[I].CodeGenOnce, [I] {
+      Components[I].InitTarget();
+      Components[I].InitAsmPrinter();
+    });
+  }
+  return T;
+}
+
+void debase_tool::InitializeBitcodeWriterFor(StringRef TT) {
+  std::string Error;
+  unsigned I = NumComponents;
+  // Without a target, the writer just skips the symbol table.
+  if (LookupTarget(TT, Error, I))
+    InitializeMCFor(I);
+}
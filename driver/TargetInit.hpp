@@ -0,0 +1,49 @@
+//===- driver/TargetInit.hpp ----------------------------------------------===//
+//
+// Copyright (C) 2026 Ninefold
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// Initializes the configured LLVM targets on demand, only for the triples
+/// which are actually used.
+///
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "LLVM.hpp"
+#include <string>
+
+namespace llvm {
+class Target;
+} // namespace llvm
+
+namespace debase_tool {
+
+/// Registers the info of every configured target, so triples can be looked
+/// up. Must be called on startup, everything else is done on demand.
+void InitializeTargetInfos();
+
+/// Initializes everything needed to create a `TargetMachine` for `TT`.
+/// Safe to call from multiple threads.
+/// @return The target, or null if unsupported.
+const llvm::Target* InitializeTargetFor(StringRef TT, std::string& Error);
+
+/// Initializes what the bitcode writer needs to emit a symbol table for `TT`.
+/// Safe to call from multiple threads.
+void InitializeBitcodeWriterFor(StringRef TT);
+
+} // namespace debase_tool
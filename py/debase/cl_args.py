@@ -28,6 +28,13 @@ def parse_args():
     choices=['all', 'non-leaf', 'none'],
     help='--frame-pointer=VALUE passed to LLC on Release'
   )
+  parser.add_argument(
+    '--use-llc',
+    dest='use_llc',
+    action='store_const',
+    default=False, const=True,
+    help='run llc on each debased file, instead of generating code in-process'
+  )
   parser.add_argument(
     '--target', '--target-name',
     dest='target',
@@ -1,4 +1,4 @@
-import json, os, sys, subprocess
+import json, os, socket, sys, subprocess
 from debase.cl_args import parse_args
 from pathlib import Path
 from hashlib import sha512
@@ -11,6 +11,32 @@ def run_process(args, _cwd):
     args = ' '.join(args)
   return subprocess.run(args, cwd=_cwd, capture_output=True, text=True)
 
+# Runs a job on the server at $DEBASE_SERVER (started with `debase --serve=PATH`)
+# Returns None if there isn't one, so the caller can run debase itself
+def run_with_server(debase_args, _cwd):
+  path = os.environ.get('DEBASE_SERVER')
+  if not path or not hasattr(socket, 'AF_UNIX'):
+    return None
+  request = {
+    'id': os.getpid(),
+    'cwd': _cwd,
+    'args': [str(arg) for arg in debase_args[1:]]
+  }
+  try:
+    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as s:
+      s.connect(path)
+      s.sendall((json.dumps(request) + '\n').encode())
+      data = b''
+      while not data.endswith(b'\n'):
+        chunk = s.recv(4096)
+        if not chunk:
+          # The server went away mid-request
+          return None
+        data += chunk
+  except OSError:
+    return None
+  return json.loads(data)
+
 # We only want to skip processing if its *exactly* the same
 def calculate_and_write_hash(debase_bin, args):
   o = Path(args.output)
@@ -25,7 +51,9 @@ def calculate_and_write_hash(debase_bin, args):
   m.update(json_result.read_bytes())
   # CL stuff
   commands = ' '.join([
+    args.build_type,
     args.frame_pointer,
+    str(args.use_llc),
     args.passthrough,
     ''.join(args.files)
   ])
@@ -48,6 +76,14 @@ def check_hash_for_target(debase_bin, args):
   # Check result
   return old_hash == new_hash
 
+def get_codegen_args(args):
+  return {
+    'Debug': ['-O=0', '--frame-pointer=none'],
+    'RelWithDebInfo': ['-O=2', '--frame-pointer=non-leaf'],
+    'MinSizeRel': ['-O=2', f'--frame-pointer={args.frame_pointer}'],
+    'Release': ['-O=3', f'--frame-pointer={args.frame_pointer}', '--regalloc=pbqp'],
+  }[args.build_type]
+
 def run_debaser(debase_bin, args):
   o = Path(args.output)
   target = Path(args.target)
@@ -55,6 +91,9 @@ def run_debaser(debase_bin, args):
   json_result = (o / 'lib' / args.jsonout)
   passthrough = args.passthrough.split(';')
   passthrough.extend(['--emit-all', '--allow-no-builtins', '--permissive'])
+  if not args.use_llc:
+    # Codegen in-process, instead of going through llc.
+    passthrough.extend(['--emit-obj', '-j0', *get_codegen_args(args)])
 
   if not (o / target).exists():
     errs('target', target.as_posix(), 'does not exist!')
@@ -80,11 +119,18 @@ def run_debaser(debase_bin, args):
 
   if args.dump:
     print(' '.join(debase_args))
-  result = run_process(debase_args, str(o))
-  if result.returncode != 0:
-    errs(result.stderr.strip())
-    errs('failed to run debaser!')
-    sys.exit(result.returncode)
+  response = run_with_server(debase_args, str(o))
+  if response is not None:
+    if response['status'] != 0:
+      errs(response.get('error', 'see the server output for details'))
+      errs('failed to run debaser!')
+      sys.exit(response['status'])
+  else:
+    result = run_process(debase_args, str(o))
+    if result.returncode != 0:
+      errs(result.stderr.strip())
+      errs('failed to run debaser!')
+      sys.exit(result.returncode)
   
   calculate_and_write_hash(debase_bin, args)
   return json_result
@@ -93,13 +139,6 @@ def run_llc(llc_bin, args, bc_files: list[str]):
   o = Path(args.output) / 'opt'
   o.mkdir(exist_ok=True)
 
-  llc_O = {
-    'Debug': ['-O=0', '--frame-pointer=none'],
-    'RelWithDebInfo': ['-O=2', '--frame-pointer=non-leaf'],
-    'MinSizeRel': ['-O=2', f'--frame-pointer={args.frame_pointer}'],
-    'Release': ['-O=3', f'--frame-pointer={args.frame_pointer}', '--regalloc=pbqp'],
-  }
-
   out_files = []
   failed = False
 
@@ -109,7 +148,7 @@ def run_llc(llc_bin, args, bc_files: list[str]):
     out = o / (Path(bc_file).stem + '.o')
     llc_args = [
       llc_bin,
-      *llc_O[args.build_type],
+      *get_codegen_args(args),
       '-filetype=obj',
       '-o', out.as_posix(),
       bc_file
@@ -176,7 +215,11 @@ def debase_main(debase_bin, llc_bin):
   if type(bc_files) is str:
     bc_files = [bc_files]
   
-  out_files = run_llc(llc_bin, args, bc_files)
+  if args.use_llc:
+    out_files = run_llc(llc_bin, args, bc_files)
+  else:
+    # Already object files.
+    out_files = bc_files
   if args.dump:
     print('files:', ' '.join(out_files))
   #run_archive(debase_bin, args, out_files)
@@ -0,0 +1,339 @@
+//===- BenchMatcher.cpp ---------------------------------------------------===//
+//
+// Copyright (C) 2026 Ninefold
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// Micro-benchmarks for the classifiers and for matching against every kind
+// of pattern, with pattern sets scaled from 10 to 10,000 entries.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Shared.hpp"
+#include "NameClassifier.hpp"
+#include "Pattern.hpp"
+#include "PatternLex.hpp"
+#include "SymbolFeatures.hpp"
+#include "SymbolMatcher.hpp"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/WithColor.h"
+#include "llvm/Support/raw_ostream.h"
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace debase_tool;
+using namespace llvm;
+
+bool debase_tool::Strict = false;
+bool debase_tool::Permissive = false;
+bool debase_tool::Verbose = false;
+std::atomic<bool>* debase_tool::RequestFailed = nullptr;
+
+cl::OptionCategory debase_tool::DebaseToolCategory("Debaser Options");
+
+static cl::OptionCategory BenchCategory("Benchmark Options");
+
+static cl::opt<double>
+MinTime("min-time",
+        cl::desc("Minimum seconds to run each benchmark for"),
+        cl::init(0.25), cl::cat(BenchCategory));
+
+static cl::opt<unsigned>
+MaxSize("max-size",
+        cl::desc("Largest pattern set to benchmark"),
+        cl::init(10000), cl::cat(BenchCategory));
+
+static cl::opt<unsigned>
+NumSymbols("symbols",
+           cl::desc("Amount of symbols matched per iteration"),
+           cl::init(1024), cl::cat(BenchCategory));
+
+static cl::opt<std::string>
+Filter("filter",
+       cl::desc("Only run benchmarks containing this string"),
+       cl::value_desc("name"), cl::cat(BenchCategory));
+
+/// Keeps results alive, so the optimizer can't remove the work.
+static volatile unsigned Sink = 0;
+
+/// Runs `Fn` (doing `Ops` operations) until `MinTime` has passed, then prints
+/// the time taken per operation.
+static void Bench(StringRef Name, unsigned Ops,
+                  function_ref<unsigned()> Fn) {
+  if (!Filter.empty() && !Name.contains(Filter))
+    return;
+  using Clock = std::chrono::steady_clock;
+  uint64_t Iters = 0;
+  unsigned Result = 0;
+  std::chrono::duration<double> Elapsed {};
+  const auto Start = Clock::now();
+  do {
+    Result += Fn();
+    ++Iters;
+    Elapsed = Clock::now() - Start;
+  } while (Elapsed.count() < MinTime);
+  Sink = Sink + Result;
+  const double NsPerOp = Elapsed.count() * 1e9 / double(Iters * Ops);
+  outs() << format("%-36s %12.1f ns/op %10u hits\n",
+                   Name.str().c_str(), NsPerOp, unsigned(Result / Iters));
+}
+
+//======================================================================//
+// Symbols
+//======================================================================//
+
+/// Mangles a ctor (`C2`) or dtor (`D2`) of `Names`, the last being the class.
+static std::string MangleItanium(ArrayRef<std::string> Names, bool IsCtor) {
+  std::string Out = "_ZN";
+  for (const std::string& N : Names)
+    Out += utostr(N.size()) + N;
+  Out += IsCtor ? "C2Ev" : "D2Ev";
+  return Out;
+}
+
+/// Mangles a ctor (`??0`) or dtor (`??1`) of `Names`, the last being the class.
+static std::string MangleMSVC(ArrayRef<std::string> Names, bool IsCtor) {
+  std::string Out = IsCtor ? "??0" : "??1";
+  for (const std::string& N : llvm::reverse(Names))
+    Out += N + "@";
+  Out += "@QEAA@XZ";
+  return Out;
+}
+
+/// A realistic mix of symbols: ctors/dtors, templates, members and plain C.
+static std::vector<std::string> MakeClassifierSymbols(bool IsMSVC) {
+  std::vector<std::string> Out;
+  for (unsigned I = 0; I < NumSymbols; ++I) {
+    const std::string NS = "ns" + utostr(I % 8);
+    const std::string Cls = "Class" + utostr(I);
+    switch (I % 6) {
+    case 0:
+      Out.push_back(IsMSVC ? MangleMSVC({NS, Cls}, true)
+                           : MangleItanium({NS, Cls}, true));
+      break;
+    case 1:
+      Out.push_back(IsMSVC ? MangleMSVC({NS, "detail", Cls}, false)
+                           : MangleItanium({NS, "detail", Cls}, false));
+      break;
+    case 2:
+      // Template ctor
+      Out.push_back(IsMSVC
+        ? "??0?$Vector@H@" + NS + "@@QEAA@XZ"
+        : "_ZN" + utostr(NS.size()) + NS + "6VectorIiEC2Ev");
+      break;
+    case 3:
+      // Member function
+      Out.push_back(IsMSVC
+        ? "?get" + utostr(I) + "@" + Cls + "@" + NS + "@@QEAAHXZ"
+        : "_ZN" + utostr(NS.size()) + NS + utostr(Cls.size()) + Cls
+            + "3getEv");
+      break;
+    case 4:
+      // Free function
+      Out.push_back(IsMSVC
+        ? "?free" + utostr(I) + "@" + NS + "@@YAXH@Z"
+        : "_ZN" + utostr(NS.size()) + NS + "4freeEi");
+      break;
+    default:
+      Out.push_back("c_function_" + utostr(I));
+      break;
+    }
+  }
+  return Out;
+}
+
+//======================================================================//
+// Patterns
+//======================================================================//
+
+namespace {
+
+/// Creates the `I`th pattern of a set, and the names of symbols for it.
+struct PatternShape {
+  StringRef Name;
+  std::function<Pattern*(SymbolMatcher&, unsigned)> Make;
+  std::function<std::vector<std::string>(unsigned)> Names;
+};
+
+} // namespace `anonymous`
+
+static Pattern* Compile(SymbolMatcher& SM, const Twine& P) {
+  auto POrErr = SM.compilePattern(P.str());
+  if (!POrErr) {
+    WithColor::error(errs()) << toString(POrErr.takeError()) << '\n';
+    std::exit(1);
+  }
+  return *POrErr;
+}
+
+static std::string GetNS(unsigned I) { return "ns" + utostr(I % 8); }
+static std::string GetClass(unsigned I) { return "K" + utostr(I); }
+
+static std::vector<PatternShape> GetPatternShapes() {
+  auto Nested = [] (unsigned I) -> std::vector<std::string> {
+    return {GetNS(I), GetClass(I)};
+  };
+  auto Global = [] (unsigned I) -> std::vector<std::string> {
+    return {GetClass(I)};
+  };
+  return {
+    {"Simple", [] (SymbolMatcher& SM, unsigned I) {
+      return Compile(SM, GetNS(I) + "::" + GetClass(I));
+    }, Nested},
+    {"LeadingSimple", [] (SymbolMatcher& SM, unsigned I) -> Pattern* {
+      StringRef Names[] = {SM.intern(GetNS(I)), SM.intern(GetClass(I))};
+      return SM.makeNew<LeadingSimplePattern>(ArrayRef(Names));
+    }, [] (unsigned I) -> std::vector<std::string> {
+      return {GetNS(I), GetClass(I), "Inner"};
+    }},
+    {"LeadingGlob", [] (SymbolMatcher& SM, unsigned I) {
+      return Compile(SM, "**::" + GetClass(I));
+    }, [] (unsigned I) -> std::vector<std::string> {
+      return {GetNS(I), "detail", GetClass(I)};
+    }},
+    {"ButterflyGlob", [] (SymbolMatcher& SM, unsigned I) {
+      return Compile(SM, GetNS(I) + "::**::" + GetClass(I));
+    }, [] (unsigned I) -> std::vector<std::string> {
+      return {GetNS(I), "detail", GetClass(I)};
+    }},
+    {"SingleSequence", [] (SymbolMatcher& SM, unsigned I) {
+      return Compile(SM, GetNS(I) + "::/" + GetClass(I) + "x?/");
+    }, Nested},
+    {"AnySequence", [] (SymbolMatcher& SM, unsigned I) {
+      return Compile(SM, GetNS(I) + "::" + GetClass(I) + "{file.stem}");
+    }, [] (unsigned I) -> std::vector<std::string> {
+      return {GetNS(I), GetClass(I) + "Bench"};
+    }},
+    {"Forwarding", [] (SymbolMatcher& SM, unsigned I) -> Pattern* {
+      auto* Solo = SM.make<SoloPattern>(SM.intern(GetClass(I)));
+      return SM.make<ForwardingPattern>(Solo);
+    }, Global},
+    {"Solo", [] (SymbolMatcher& SM, unsigned I) -> Pattern* {
+      return SM.make<SoloPattern>(SM.intern(GetClass(I)));
+    }, Global},
+    {"Regex", [] (SymbolMatcher& SM, unsigned I) -> Pattern* {
+      return SM.make<RegexPattern>(SM.intern(GetClass(I) + "_?[a-z]+"));
+    }, [] (unsigned I) -> std::vector<std::string> {
+      return {GetClass(I) + "_impl"};
+    }},
+  };
+}
+
+/// Matches symbols against a set of `Size` patterns of `Shape`. Around one in
+/// eight symbols has a matching pattern.
+static void BenchShape(const PatternShape& Shape, unsigned Size) {
+  const std::string Name =
+    ("match/" + Shape.Name + "/" + Twine(Size)).str();
+  if (!Filter.empty() && !StringRef(Name).contains(Filter))
+    return;
+
+  // Patterns are owned elsewhere, like those from `--patterns`.
+  SymbolMatcher Owner;
+  SymbolMatcher SM;
+  for (unsigned I = 0; I < Size; ++I)
+    SM.addExternalPattern(Shape.Make(Owner, I));
+  if (Error E = Owner.setFilename("Bench.cpp")) {
+    WithColor::error(errs()) << toString(std::move(E)) << '\n';
+    std::exit(1);
+  }
+
+  // Features reference the symbols, so they're built up front.
+  std::vector<std::string> Syms;
+  for (unsigned I = 0; I < NumSymbols; ++I) {
+    // Every 8th symbol names a pattern, the rest are just past the set.
+    const unsigned Ix = (I % 8 == 0) ? (I * 7919) % Size : Size + I;
+    const bool IsCtor = (I & 1) == 0;
+    Syms.push_back(MangleItanium(Shape.Names(Ix), IsCtor));
+  }
+  ItaniumClassifier C;
+  std::vector<SymbolFeatures> Features(Syms.size());
+  for (unsigned I = 0, E = Syms.size(); I != E; ++I)
+    C.classify(Syms[I], &Features[I]);
+
+  const auto Start = std::chrono::steady_clock::now();
+  SM.compilePatterns();
+  const std::chrono::duration<double, std::micro> CompileTime =
+    std::chrono::steady_clock::now() - Start;
+
+  Bench(Name, NumSymbols, [&] {
+    unsigned Hits = 0;
+    for (const SymbolFeatures& F : Features)
+      Hits += SM.match(F);
+    return Hits;
+  });
+  outs().indent(2) << format("compiled in %.1f us\n", CompileTime.count());
+}
+
+int main(int Argc, char** Argv) {
+  InitLLVM X(Argc, Argv);
+  cl::HideUnrelatedOptions(BenchCategory);
+  cl::ParseCommandLineOptions(Argc, Argv, "debase micro-benchmarks\n");
+
+  // Names reference the strings, so keep them around.
+  const std::vector<std::string> ItaniumSyms = MakeClassifierSymbols(false);
+  const std::vector<std::string> MSVCSyms = MakeClassifierSymbols(true);
+
+  ItaniumClassifier IClass;
+  MSVCClassifier MClass;
+  auto BenchClassify = [] (StringRef Name, Classifier& C,
+                           ArrayRef<std::string> Syms) {
+    SymbolFeatures F;
+    Bench(Name, Syms.size(), [&] {
+      unsigned CtorDtors = 0;
+      for (const std::string& Sym : Syms) {
+        F.clear();
+        SymbolKind K = C.classify(Sym, &F);
+        CtorDtors += (K == SymbolKind::Constructor
+                   || K == SymbolKind::Destructor);
+      }
+      return CtorDtors;
+    });
+  };
+  BenchClassify("classify/itanium", IClass, ItaniumSyms);
+  BenchClassify("classify/msvc", MClass, MSVCSyms);
+
+  // Long literal patterns, like those in generated configs.
+  std::vector<std::string> LiteralPats;
+  for (unsigned I = 0; I < 64; ++I) {
+    std::string P;
+    for (unsigned Depth = 0; Depth < 6; ++Depth)
+      P += GetNS(I + Depth) + "_detail::";
+    LiteralPats.push_back(P + GetClass(I));
+  }
+  Bench("lex/literal", LiteralPats.size(), [&] {
+    BumpPtrAllocator BP;
+    SmallVector<Pattern::Token> Toks;
+    unsigned NumToks = 0;
+    for (const std::string& P : LiteralPats) {
+      if (Error E = lexTokensForPattern(P, Toks, BP)) {
+        WithColor::error(errs()) << toString(std::move(E)) << '\n';
+        std::exit(1);
+      }
+      NumToks += Toks.size();
+    }
+    return NumToks;
+  });
+
+  for (const PatternShape& Shape : GetPatternShapes())
+    for (unsigned Size = 10; Size <= MaxSize; Size *= 10)
+      BenchShape(Shape, Size);
+  return 0;
+}
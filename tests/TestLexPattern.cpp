@@ -16,17 +16,73 @@
 //
 //===----------------------------------------------------------------------===//
 
+//
+// Checks which patterns lex, and that the literal fast path gives the same
+// tokens as the scalar lexer for every one of them.
+//
+//===----------------------------------------------------------------------===//
+
 #include "Shared.hpp"
 #include "FilePropertyCache.hpp"
-#include "LLVMTargets.hpp"
-#include "NameClassifier.hpp"
 #include "SymbolFeatures.hpp"
 #include "SymbolMatcher.hpp"
 #include "Pattern.hpp"
 #include "PatternLex.hpp"
-#include "Triple.hpp"
-#include "UnlinkRefs.hpp"
-#include "llvm/Demangle/Demangle.h"
+#include "llvm/Support/BuryPointer.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/WithColor.h"
+#include "llvm/Support/raw_ostream.h"
+#include <optional>
+#include <string>
+
+using namespace debase_tool;
+using namespace llvm;
+
+bool debase_tool::Strict = false;
+bool debase_tool::Permissive = false;
+bool debase_tool::Verbose = false;
+std::atomic<bool>* debase_tool::RequestFailed = nullptr;
+
+cl::OptionCategory debase_tool::DebaseToolCategory("Debaser Options");
+
+/// Lexes `P` with and without the literal fast path, which must agree on the
+/// error or every token.
+static bool CheckFastPath(StringRef P, llvm::BumpPtrAllocator& BP,
+                          FilePropertyCache* Prop, int Indent) {
+  auto Lex = [&] (bool Fast, SmallVectorImpl<Pattern::Token>& Toks) {
+    LexLiteralFastPath = Fast;
+    Error E = lexTokensForPattern(P, Toks, BP, Prop);
+    LexLiteralFastPath = true;
+    return E ? toString(std::move(E)) : std::string();
+  };
+  SmallVector<Pattern::Token> Fast, Scalar;
+  const std::string FastErr = Lex(true, Fast);
+  const std::string ScalarErr = Lex(false, Scalar);
+
+  bool Same = (FastErr == ScalarErr) && Fast.size() == Scalar.size();
+  for (size_t I = 0; Same && I < Fast.size(); ++I) {
+    const Pattern::Token& A = Fast[I];
+    const Pattern::Token& B = Scalar[I];
+    Same = A.kind == B.kind && A.str() == B.str()
+        && A.trailing == B.trailing && A.grouped == B.grouped
+        && A.modified == B.modified;
+  }
+  if (Same)
+    return true;
+
+  outs().indent(Indent * 2);
+  WithColor(outs(), raw_ostream::RED)
+    << "pattern '" << P << "' differs from the scalar lexer.\n";
+  outs().indent((Indent + 1) * 2) << "fast:   ";
+  if (FastErr.empty())
+    printTokenGroup(outs(), Fast);
+  outs() << FastErr << '\n';
+  outs().indent((Indent + 1) * 2) << "scalar: ";
+  if (ScalarErr.empty())
+    printTokenGroup(outs(), Scalar);
+  outs() << ScalarErr << "\n\n";
+  return false;
+}
 
 static bool TestLexPattern(StringRef P, const bool ShouldPass,
                            llvm::BumpPtrAllocator& BP,
@@ -43,7 +99,7 @@ static bool TestLexPattern(StringRef P, const bool ShouldPass,
         << "pattern '" << P << "' failed.\n";
     }
     outs().indent((Indent + 1) * 2) << toString(std::move(E)) << "\n\n";
-    return !ShouldPass;
+    return !ShouldPass && CheckFastPath(P, BP, Prop, Indent);
   }
 
   outs().indent(Indent * 2);
@@ -59,7 +115,7 @@ static bool TestLexPattern(StringRef P, const bool ShouldPass,
   printTokenGroup(outs(), Toks);
   outs() << "\n\n";
 
-  return ShouldPass;
+  return ShouldPass && CheckFastPath(P, BP, Prop, Indent);
 }
 
 static bool TestLexGroup(StringRef Name, ArrayRef<std::pair<StringRef, bool>> Patterns,
@@ -72,13 +128,30 @@ static bool TestLexGroup(StringRef Name, ArrayRef<std::pair<StringRef, bool>> Pa
   return Result;
 }
 
+/// Only checks the fast path agrees with the scalar lexer, whatever the result.
+static bool TestFastPathGroup(StringRef Name, ArrayRef<StringRef> Patterns,
+                              llvm::BumpPtrAllocator& BP) {
+  WithColor(outs(), raw_ostream::YELLOW) << Name << ":\n";
+  bool Result = true;
+  for (StringRef P : Patterns) {
+    if (!CheckFastPath(P, BP, nullptr, 1)) {
+      Result = false;
+      continue;
+    }
+    outs().indent(2);
+    WithColor(outs(), raw_ostream::GREEN)
+      << "pattern '" << P << "' matches the scalar lexer.\n";
+  }
+  return Result;
+}
+
 #define LEX_TESTS(NAME, ...) [&Result, &BP, &Prop] () {   \
   std::pair<StringRef, bool> Patterns[] { __VA_ARGS__ };  \
   FilePropertyCache* P = Prop ? &*Prop : nullptr;         \
   Result = TestLexGroup(NAME, Patterns, BP, P) && Result; \
 }()
 
-static void RunLexTests(bool Exit = true) {
+static bool RunLexTests() {
   llvm::BumpPtrAllocator BP;
   std::optional<FilePropertyCache> Prop;
   bool Result = true;
@@ -194,13 +267,42 @@ static void RunLexTests(bool Exit = true) {
     {"I[{file.stem}]",    false},
   );
 
-  if (Exit)
-    std::exit(Result ? 0 : 1);
+  // Edge cases at the boundaries of the literal run.
+  StringRef FastPathPatterns[] {
+    "a:::b",
+    "a::::b",
+    "a:: b",
+    "a ::b",
+    "1a::b",
+    "a::1b",
+    "a:b::c",
+    "a::b{this.stem}",
+    "a::b::I?Foo",
+    "**::a::b::C",
+    "a::**::b::C",
+    "a::b\xC3\xA9::C",
+    "\x80::a",
+    "abcdefghijklmnop::qrstuvwxyz_0123456789::$Klass",
+    "abcdefghijklmnopq::r::I?Foo",
+    "abcdefghijklmnopqrstuvwxyz::\xFF",
+    "abcdefghijklmnopqrstuvwxyz0123:::x",
+    "abcdefghijklmnop::qrstuvwxyz::1abc",
+  };
+  Result = TestFastPathGroup("Fast Path", FastPathPatterns, BP) && Result;
+
+  return Result;
+}
+
+/// Checks `Cond`, failing the test with `Msg` if it's false.
+static bool Expect(bool Cond, StringRef Msg) {
+  if (!Cond)
+    WithColor(outs(), raw_ostream::RED) << "expected " << Msg << '\n';
+  return Cond;
 }
 
-int main() {
+int main(int Argc, char** Argv) {
   InitLLVM X(Argc, Argv);
-  RunLexTests(false);
+  bool Result = RunLexTests();
 
   auto SM = std::make_unique<SymbolMatcher>();
   auto LoadPattern = [&SM] (StringRef pattern) -> Pattern* {
@@ -234,15 +336,22 @@ int main() {
 
   SetFilename("bindings/CCScheduler.cpp");
   PrintPatterns(P);
-  assert(P[0]->matchSymbol({"x", "y", "z", "ICCScheduler"}));
-  assert(P[1]->matchSymbol({"cocos2d", "CCScheduler"}));
-  assert(P[2]->matchSymbol({"x", "y", "z", "CCScheduler"}));
+  Result &= Expect(P[0]->matchSymbol({"x", "y", "z", "ICCScheduler"}),
+                   "x::y::z::ICCScheduler to match");
+  Result &= Expect(P[1]->matchSymbol({"cocos2d", "CCScheduler"}),
+                   "cocos2d::CCScheduler to match");
+  Result &= Expect(P[2]->matchSymbol({"x", "y", "z", "CCScheduler"}),
+                   "x::y::z::CCScheduler to match");
 
   SetFilename("bindings/CCLightning.cpp");
   PrintPatterns(P);
-  assert(P[0]->matchSymbol({"x", "yyy", "z", "CCLightning"}));
-  assert(P[1]->matchSymbol({"cocos2d", "CCLightning"}));
-  assert(P[2]->matchSymbol({"cocos2d", "CCLightning"}));
+  Result &= Expect(P[0]->matchSymbol({"x", "yyy", "z", "CCLightning"}),
+                   "x::yyy::z::CCLightning to match");
+  Result &= Expect(P[1]->matchSymbol({"cocos2d", "CCLightning"}),
+                   "cocos2d::CCLightning to match");
+  Result &= Expect(P[2]->matchSymbol({"cocos2d", "CCLightning"}),
+                   "cocos2d::CCLightning to match");
 
   llvm::BuryPointer(std::move(SM));
+  return Result ? 0 : 1;
 }